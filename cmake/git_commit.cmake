@@ -0,0 +1,22 @@
+# Writes the git commit of SOURCE_DIR to OUTPUT from the template INPUT. Run at build time by the
+# pmr-git-commit target, so results name the commit a binary was built from even if CMake isn't
+# rerun. configure_file leaves OUTPUT untouched when the commit hasn't changed, so nothing is
+# rebuilt needlessly.
+
+set(PMR_GIT_COMMIT "unknown")
+
+if(GIT_EXECUTABLE)
+    execute_process(
+        COMMAND "${GIT_EXECUTABLE}" describe --always --dirty
+        WORKING_DIRECTORY "${SOURCE_DIR}"
+        OUTPUT_VARIABLE git_commit
+        OUTPUT_STRIP_TRAILING_WHITESPACE
+        ERROR_QUIET
+    )
+
+    if(git_commit)
+        set(PMR_GIT_COMMIT "${git_commit}")
+    endif()
+endif()
+
+configure_file("${INPUT}" "${OUTPUT}" @ONLY)
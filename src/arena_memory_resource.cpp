@@ -0,0 +1,112 @@
+#include "arena_memory_resource.hpp"
+
+#include <algorithm>
+#include <cstdint>
+
+namespace dr
+{
+namespace
+{
+
+// Chunk headers take up the first header_size bytes of each chunk
+constexpr std::size_t header_size = alignof(std::max_align_t);
+static_assert(sizeof(ArenaMemoryResource::Chunk) <= header_size);
+
+std::byte* align_up(std::byte* ptr, std::size_t alignment)
+{
+    const auto addr = reinterpret_cast<std::uintptr_t>(ptr);
+    return reinterpret_cast<std::byte*>((addr + alignment - 1) & ~(alignment - 1));
+}
+
+std::byte* chunk_begin(ArenaMemoryResource::Chunk* chunk)
+{
+    return reinterpret_cast<std::byte*>(chunk) + header_size;
+}
+
+std::byte* chunk_end(ArenaMemoryResource::Chunk* chunk)
+{
+    return reinterpret_cast<std::byte*>(chunk) + chunk->size;
+}
+
+bool fits(std::byte* top, std::byte* end, std::size_t bytes, std::size_t alignment)
+{
+    if (top == nullptr) return false;
+    std::byte* const ptr = align_up(top, alignment);
+    return ptr <= end && bytes <= std::size_t(end - ptr);
+}
+
+} // namespace
+
+void ArenaMemoryResource::rewind(const Marker& marker)
+{
+    curr = marker.chunk;
+    top = marker.top;
+    end = curr != nullptr ? chunk_end(curr) : nullptr;
+}
+
+void ArenaMemoryResource::release()
+{
+    while (chunks != nullptr)
+    {
+        Chunk* const next = chunks->next;
+        upstream->deallocate(chunks, chunks->size, header_size);
+        chunks = next;
+    }
+
+    curr = nullptr;
+    top = end = nullptr;
+}
+
+void* ArenaMemoryResource::do_allocate(std::size_t bytes, std::size_t alignment)
+{
+    if (!fits(top, end, bytes, alignment))
+    {
+        // Reuse the next chunk if it was kept by a rewind, otherwise insert a new one
+        Chunk* next = curr != nullptr ? curr->next : chunks;
+
+        if (next == nullptr || !fits(chunk_begin(next), chunk_end(next), bytes, alignment))
+        {
+            const std::size_t size = std::max(next_chunk_size, header_size + bytes + alignment);
+            Chunk* const chunk = static_cast<Chunk*>(upstream->allocate(size, header_size));
+            *chunk = {next, size};
+
+            if (curr != nullptr)
+                curr->next = chunk;
+            else
+                chunks = chunk;
+
+            next = chunk;
+            next_chunk_size *= 2;
+        }
+
+        curr = next;
+        top = chunk_begin(curr);
+        end = chunk_end(curr);
+    }
+
+    std::byte* const ptr = align_up(top, alignment);
+    top = ptr + bytes;
+    return ptr;
+}
+
+void ArenaMemoryResource::do_deallocate(void* ptr, std::size_t bytes, std::size_t /*alignment*/)
+{
+    if (static_cast<std::byte*>(ptr) + bytes == top)
+        top = static_cast<std::byte*>(ptr);
+}
+
+bool ArenaMemoryResource::do_try_expand(void* ptr, std::size_t old_bytes, std::size_t new_bytes, std::size_t /*alignment*/)
+{
+    std::byte* const begin = static_cast<std::byte*>(ptr);
+
+    if (begin + old_bytes != top)
+        return new_bytes <= old_bytes;
+
+    if (new_bytes > std::size_t(end - begin))
+        return false;
+
+    top = begin + new_bytes;
+    return true;
+}
+
+} // namespace dr
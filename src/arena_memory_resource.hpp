@@ -0,0 +1,89 @@
+#pragma once
+
+#include <cstddef>
+#include <memory_resource>
+
+#include "expandable_memory_resource.hpp"
+
+namespace dr
+{
+
+// Bump allocator that can be rewound to a previously marked position. Rewinding gives back
+// everything allocated since the mark in O(1) and keeps the chunks for reuse, so a loop that
+// rewinds on each iteration reaches a steady state without going back to upstream.
+//
+// As with monotonic_buffer_resource, deallocation is a no-op (except for the most recent
+// allocation, whose space is reused). Likewise, only the most recent allocation can grow in
+// place. Chunks are returned to upstream on release() or destruction.
+struct ArenaMemoryResource : public ExpandableMemoryResource
+{
+    struct Chunk
+    {
+        Chunk* next;
+        std::size_t size;
+    };
+
+    struct Marker
+    {
+        Chunk* chunk;
+        std::byte* top;
+    };
+
+    std::pmr::memory_resource* upstream;
+    std::size_t next_chunk_size;
+    Chunk* chunks{};
+    Chunk* curr{};
+    std::byte* top{};
+    std::byte* end{};
+
+    ArenaMemoryResource(
+        std::pmr::memory_resource* upstream,
+        std::size_t initial_chunk_size = 4096) :
+        upstream{upstream}, next_chunk_size{initial_chunk_size} {}
+
+    ArenaMemoryResource(const ArenaMemoryResource&) = delete;
+    ArenaMemoryResource& operator=(const ArenaMemoryResource&) = delete;
+
+    ~ArenaMemoryResource() { release(); }
+
+    Marker mark() const { return {curr, top}; }
+
+    // Gives back everything allocated since the given marker was taken
+    void rewind(const Marker& marker);
+
+    // Returns all chunks to upstream
+    void release();
+
+    void* do_allocate(std::size_t bytes, std::size_t alignment) override;
+    void do_deallocate(void* ptr, std::size_t bytes, std::size_t alignment) override;
+    bool do_try_expand(void* ptr, std::size_t old_bytes, std::size_t new_bytes, std::size_t alignment) override;
+
+    bool do_is_equal(const std::pmr::memory_resource& other) const noexcept override
+    {
+        return this == &other;
+    };
+};
+
+// Marks an arena on construction and rewinds it on destruction. Does nothing if the arena is
+// null, so the same code can run with or without scratch scopes.
+struct ArenaScope
+{
+    ArenaMemoryResource* arena;
+    ArenaMemoryResource::Marker marker{};
+
+    ArenaScope(ArenaMemoryResource* arena) :
+        arena{arena}
+    {
+        if (arena != nullptr) marker = arena->mark();
+    }
+
+    ArenaScope(const ArenaScope&) = delete;
+    ArenaScope& operator=(const ArenaScope&) = delete;
+
+    ~ArenaScope()
+    {
+        if (arena != nullptr) arena->rewind(marker);
+    }
+};
+
+} // namespace dr
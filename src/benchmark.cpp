@@ -0,0 +1,117 @@
+#include "benchmark.hpp"
+
+#include <algorithm>
+#include <cmath>
+
+#include <fmt/format.h>
+
+namespace dr
+{
+namespace
+{
+
+// Returns the nearest-rank percentile (0-100) of sorted values
+double percentile(const std::vector<double>& sorted, double p)
+{
+    const double rank = std::ceil(p / 100.0 * sorted.size());
+    const std::size_t index = rank > 0 ? static_cast<std::size_t>(rank) - 1 : 0;
+    return sorted[std::min(index, sorted.size() - 1)];
+}
+
+double median(const std::vector<double>& sorted)
+{
+    const std::size_t n = sorted.size();
+    return n % 2 != 0 ? sorted[n / 2] : (sorted[n / 2 - 1] + sorted[n / 2]) / 2;
+}
+
+std::string format_count(double count)
+{
+    if (count < 1e3)
+        return fmt::format("{:.0f}", count);
+    if (count < 1e6)
+        return fmt::format("{:.1f}k", count / 1e3);
+    if (count < 1e9)
+        return fmt::format("{:.2f}M", count / 1e6);
+
+    return fmt::format("{:.2f}G", count / 1e9);
+}
+
+} // namespace
+
+BenchmarkResult summarize(std::vector<double> samples)
+{
+    BenchmarkResult result{std::move(samples)};
+
+    if (result.samples.empty())
+        return result;
+
+    std::vector<double> sorted = result.samples;
+    std::sort(sorted.begin(), sorted.end());
+
+    result.median = median(sorted);
+    result.min = sorted.front();
+    result.max = sorted.back();
+    result.p90 = percentile(sorted, 90);
+    result.p99 = percentile(sorted, 99);
+
+    for (double& value : sorted)
+        value = std::abs(value - result.median);
+
+    std::sort(sorted.begin(), sorted.end());
+    result.mad = median(sorted);
+
+    return result;
+}
+
+std::string format_duration(double ns)
+{
+    if (ns < 1e3)
+        return fmt::format("{:.0f} ns", ns);
+    if (ns < 1e6)
+        return fmt::format("{:.2f} us", ns / 1e3);
+    if (ns < 1e9)
+        return fmt::format("{:.2f} ms", ns / 1e6);
+
+    return fmt::format("{:.2f} s", ns / 1e9);
+}
+
+std::string format_summary(const BenchmarkResult& result)
+{
+    return fmt::format(
+        "median {}, MAD {:.1f}%, min {}, p90 {}, p99 {}, {} runs",
+        format_duration(result.median),
+        result.median > 0 ? 100.0 * result.mad / result.median : 0.0,
+        format_duration(result.min),
+        format_duration(result.p90),
+        format_duration(result.p99),
+        result.samples.size());
+}
+
+void print_counters(const BenchmarkResult& result)
+{
+    const std::vector<double>& counts = result.counters;
+
+    if (counts.empty())
+        return;
+
+    std::string line{};
+
+    for (std::size_t i = 0; i < counts.size(); ++i)
+    {
+        if (counts[i] < 0)
+            continue;
+
+        std::string name{PerfCounters::names[i]};
+        std::replace(name.begin(), name.end(), '_', ' ');
+        line += fmt::format("{}{} {}", line.empty() ? "" : ", ", name, format_count(counts[i]));
+
+        // Instructions follow cycles
+        if (i == 1 && counts[0] > 0)
+            line += fmt::format(" ({:.2f} IPC)", counts[1] / counts[0]);
+    }
+
+    if (!line.empty())
+        fmt::print("  {}\n", line);
+}
+
+} // namespace dr
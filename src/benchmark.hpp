@@ -0,0 +1,152 @@
+#pragma once
+
+#include <chrono>
+#include <cstddef>
+#include <functional>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "heap_profiler.hpp"
+#include "perf_counters.hpp"
+
+namespace dr
+{
+
+// Controls how many times run_benchmark repeats a test. After the warmup runs, the test is repeated
+// until it has run at least min_runs times for at least min_time in total, or max_runs is reached.
+// Fast tests therefore get more samples than slow ones.
+//
+// Runs are capped since some resources (e.g. monotonic buffers) grow on every run unless they're
+// released between runs.
+struct BenchmarkConfig
+{
+    int warmup_runs{1};
+    std::size_t min_runs{10};
+    std::size_t max_runs{100};
+    std::chrono::nanoseconds min_time{std::chrono::milliseconds{100}};
+};
+
+// Timings of each run in nanoseconds, in run order, plus a summary of their distribution
+struct BenchmarkResult
+{
+    std::vector<double> samples{};
+    double median{};
+
+    // Median absolute deviation from the median, a spread estimate that ignores outliers
+    double mad{};
+
+    double min{};
+    double max{};
+    double p90{};
+    double p99{};
+
+    // Count per run of each of PerfCounters::names (-1 if not counted), or empty if perf counters
+    // weren't enabled
+    std::vector<double> counters{};
+};
+
+// Computes the summary of the given samples
+BenchmarkResult summarize(std::vector<double> samples);
+
+// If given, release is called before each run, outside the timed region and the perf counters.
+// Resources that never give memory back (e.g. monotonic buffers) should release what the previous
+// run left so every run starts from the same state, as on a freshly built stack.
+template <typename Test>
+BenchmarkResult run_benchmark(Test&& test, const std::function<void()>& release, const BenchmarkConfig& config = {})
+{
+    using Clock = std::chrono::steady_clock;
+
+    for (int i = 0; i < config.warmup_runs; ++i)
+    {
+        if (release) release();
+        test();
+    }
+
+    std::vector<double> samples{};
+    Clock::duration total{};
+    PerfCounters* const counters = get_perf_counters();
+    std::vector<double> counts{};
+
+    if (counters != nullptr && !release)
+        counters->start();
+
+    while (samples.size() < config.max_runs)
+    {
+        if (release)
+        {
+            release();
+
+            if (counters != nullptr)
+                counters->start();
+        }
+
+        const auto start = Clock::now();
+        test();
+        const auto elapsed = Clock::now() - start;
+
+        // Counts are summed per run so releases aren't counted
+        if (counters != nullptr && release)
+        {
+            const std::vector<double> run_counts = counters->stop();
+
+            if (counts.empty())
+                counts = run_counts;
+            else
+            {
+                for (std::size_t i = 0; i < counts.size(); ++i)
+                {
+                    if (counts[i] >= 0)
+                        counts[i] += run_counts[i];
+                }
+            }
+        }
+
+        samples.push_back(std::chrono::duration<double, std::nano>(elapsed).count());
+        total += elapsed;
+
+        if (samples.size() >= config.min_runs && total >= config.min_time)
+            break;
+    }
+
+    if (counters != nullptr && !release)
+        counts = counters->stop();
+
+    BenchmarkResult result = summarize(std::move(samples));
+
+    for (double& count : counts)
+    {
+        if (count >= 0)
+            count /= result.samples.size();
+    }
+
+    result.counters = std::move(counts);
+
+    // Between tests, so the dump doesn't land in a timed run
+    write_requested_heap_profile();
+    return result;
+}
+
+template <typename Test>
+BenchmarkResult run_benchmark(Test&& test, const BenchmarkConfig& config = {})
+{
+    return run_benchmark(std::forward<Test>(test), nullptr, config);
+}
+
+// Returns the total number of runs, including warmup
+inline std::size_t total_runs(const BenchmarkResult& result, const BenchmarkConfig& config = {})
+{
+    return result.samples.size() + config.warmup_runs;
+}
+
+// Formats a duration in nanoseconds with a unit that suits it, e.g. "1.52 ms"
+std::string format_duration(double ns);
+
+// Formats the summary as e.g. "median 1.52 ms, MAD 0.8%, min 1.49 ms, p90 1.61 ms, p99 1.70 ms, 66 runs"
+std::string format_summary(const BenchmarkResult& result);
+
+// Prints the counts per run of a result, if it has any, e.g.
+// "  cycles 2.41M, instructions 6.12M (2.54 IPC), l1d misses 31.2k, ..."
+void print_counters(const BenchmarkResult& result);
+
+} // namespace dr
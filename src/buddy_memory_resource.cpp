@@ -0,0 +1,147 @@
+#include "buddy_memory_resource.hpp"
+
+#include <algorithm>
+
+namespace dr
+{
+namespace
+{
+
+constexpr int min_block_shift = 5; // log2(min_block_size)
+static_assert(std::size_t{1} << min_block_shift == BuddyMemoryResource::min_block_size);
+
+// Smallest order whose blocks hold the given size
+int order_of(std::size_t size)
+{
+    if (size <= BuddyMemoryResource::min_block_size) return 0;
+    return 64 - __builtin_clzll(size - 1) - min_block_shift;
+}
+
+std::size_t order_size(int order) { return BuddyMemoryResource::min_block_size << order; }
+
+} // namespace
+
+BuddyMemoryResource::BuddyMemoryResource(std::size_t capacity, std::pmr::memory_resource* upstream) :
+    upstream{upstream}
+{
+    num_orders = std::min(order_of(capacity) + 1, max_orders);
+    this->capacity = order_size(num_orders - 1);
+
+    region = static_cast<std::byte*>(upstream->allocate(this->capacity, max_alignment));
+    block_states.resize(this->capacity / min_block_size);
+    push_free(0, num_orders - 1);
+}
+
+BuddyMemoryResource::~BuddyMemoryResource()
+{
+    upstream->deallocate(region, capacity, max_alignment);
+}
+
+void BuddyMemoryResource::push_free(std::size_t index, int order)
+{
+    auto* const block = reinterpret_cast<FreeBlock*>(region + index * min_block_size);
+    FreeBlock*& head = free_lists[order];
+
+    *block = {head, nullptr};
+    if (head != nullptr) head->prev = block;
+    head = block;
+
+    free_orders |= std::uint64_t{1} << order;
+    block_states[index] = std::uint8_t(order + 1);
+}
+
+void BuddyMemoryResource::remove_free(std::size_t index, int order)
+{
+    auto* const block = reinterpret_cast<FreeBlock*>(region + index * min_block_size);
+
+    if (block->next != nullptr) block->next->prev = block->prev;
+
+    if (block->prev != nullptr)
+        block->prev->next = block->next;
+    else
+        free_lists[order] = block->next;
+
+    if (free_lists[order] == nullptr)
+        free_orders &= ~(std::uint64_t{1} << order);
+
+    block_states[index] = 0;
+}
+
+std::size_t BuddyMemoryResource::largest_free_block() const
+{
+    return free_orders != 0 ? order_size(63 - __builtin_clzll(free_orders)) : 0;
+}
+
+double BuddyMemoryResource::internal_fragmentation() const
+{
+    return max_block_bytes > 0 ? 1.0 - double(requested_bytes_at_max) / double(max_block_bytes) : 0.0;
+}
+
+double BuddyMemoryResource::external_fragmentation() const
+{
+    const std::size_t free_bytes = capacity - max_block_bytes;
+    return free_bytes > 0 ? 1.0 - double(largest_free_at_max) / double(free_bytes) : 0.0;
+}
+
+void* BuddyMemoryResource::do_allocate(std::size_t bytes, std::size_t alignment)
+{
+    // Blocks are aligned to their size
+    const int order = order_of(std::max(bytes, alignment));
+    const std::uint64_t candidates = order < num_orders ? free_orders & (~std::uint64_t{0} << order) : 0;
+
+    if (alignment > max_alignment || candidates == 0)
+        return upstream->allocate(bytes, alignment);
+
+    // Take the smallest free block that fits and split it down to size
+    int k = __builtin_ctzll(candidates);
+    const std::size_t index = (reinterpret_cast<std::byte*>(free_lists[k]) - region) / min_block_size;
+    remove_free(index, k);
+
+    while (k > order)
+    {
+        --k;
+        push_free(index + (order_size(k) / min_block_size), k);
+    }
+
+    requested_bytes += bytes;
+    block_bytes += order_size(order);
+
+    if (block_bytes > max_block_bytes)
+    {
+        max_block_bytes = block_bytes;
+        requested_bytes_at_max = requested_bytes;
+        largest_free_at_max = largest_free_block();
+    }
+
+    return region + index * min_block_size;
+}
+
+void BuddyMemoryResource::do_deallocate(void* ptr, std::size_t bytes, std::size_t alignment)
+{
+    if (!owns(ptr))
+    {
+        upstream->deallocate(ptr, bytes, alignment);
+        return;
+    }
+
+    int order = order_of(std::max(bytes, alignment));
+    std::size_t index = (static_cast<std::byte*>(ptr) - region) / min_block_size;
+
+    requested_bytes -= bytes;
+    block_bytes -= order_size(order);
+
+    // Merge with the buddy for as long as it's free
+    while (order < num_orders - 1)
+    {
+        const std::size_t buddy = index ^ (order_size(order) / min_block_size);
+        if (block_states[buddy] != order + 1) break;
+
+        remove_free(buddy, order);
+        index = std::min(index, buddy);
+        ++order;
+    }
+
+    push_free(index, order);
+}
+
+} // namespace dr
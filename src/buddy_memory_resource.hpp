@@ -0,0 +1,83 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory_resource>
+#include <vector>
+
+namespace dr
+{
+
+// Binary buddy allocator over a contiguous, power-of-two sized region. Requests are rounded up
+// to a power-of-two block which is found by splitting larger free blocks in O(log n). Freed
+// blocks merge with their buddy while it is also free.
+//
+// The region is requested from upstream once on construction. Requests that don't fit in the
+// region (or need stricter alignment than it provides) fall back to upstream.
+struct BuddyMemoryResource : public std::pmr::memory_resource
+{
+    static constexpr std::size_t min_block_size = 32;
+    static constexpr std::size_t max_alignment = 4096;
+    static constexpr int max_orders = 48;
+
+    struct FreeBlock
+    {
+        FreeBlock* next;
+        FreeBlock* prev;
+    };
+
+    std::pmr::memory_resource* upstream;
+    std::byte* region{};
+    std::size_t capacity{};
+    int num_orders{};
+    FreeBlock* free_lists[max_orders]{};
+    std::uint64_t free_orders{};
+
+    // One entry per min-sized block: order + 1 if a free block of that order starts there, 0
+    // otherwise
+    std::vector<std::uint8_t> block_states{};
+
+    // Bytes requested by and handed out to live allocations
+    std::size_t requested_bytes{};
+    std::size_t block_bytes{};
+
+    // Measured when block_bytes peaks
+    std::size_t max_block_bytes{};
+    std::size_t requested_bytes_at_max{};
+    std::size_t largest_free_at_max{};
+
+    // Capacity is rounded up to a power of two
+    BuddyMemoryResource(
+        std::size_t capacity,
+        std::pmr::memory_resource* upstream = std::pmr::new_delete_resource());
+
+    BuddyMemoryResource(const BuddyMemoryResource&) = delete;
+    BuddyMemoryResource& operator=(const BuddyMemoryResource&) = delete;
+
+    ~BuddyMemoryResource();
+
+    bool owns(const void* ptr) const { return ptr >= region && ptr < region + capacity; }
+
+    // Size of the largest block that can currently be allocated from the region
+    std::size_t largest_free_block() const;
+
+    // Fraction of block bytes not requested by the caller, at peak usage
+    double internal_fragmentation() const;
+
+    // Fraction of free bytes outside of the largest free block, at peak usage
+    double external_fragmentation() const;
+
+    void* do_allocate(std::size_t bytes, std::size_t alignment) override;
+    void do_deallocate(void* ptr, std::size_t bytes, std::size_t alignment) override;
+
+    bool do_is_equal(const std::pmr::memory_resource& other) const noexcept override
+    {
+        return this == &other;
+    };
+
+  private:
+    void push_free(std::size_t index, int order);
+    void remove_free(std::size_t index, int order);
+};
+
+} // namespace dr
@@ -0,0 +1,115 @@
+#include "checked_memory_resource.hpp"
+
+#include <fmt/core.h>
+
+namespace dr
+{
+namespace
+{
+
+struct
+{
+    std::size_t sample_rate{};
+    std::size_t num_violations{};
+} state;
+
+// Only the first few leaks of each resource are listed
+constexpr std::size_t max_leaks_listed = 10;
+
+} // namespace
+
+CheckedMemoryResource::CheckedMemoryResource(std::pmr::memory_resource* upstream, std::size_t sample_rate) :
+    upstream{upstream}, sample_rate{sample_rate} {}
+
+CheckedMemoryResource::~CheckedMemoryResource()
+{
+    if (blocks.empty())
+        return;
+
+    std::size_t leaked_bytes = 0;
+    for (const auto& [ptr, block] : blocks)
+        leaked_bytes += block.bytes;
+
+    fmt::print(stderr, "leak: {} blocks ({} bytes) not deallocated", blocks.size(), leaked_bytes);
+
+    if (sample_rate > 1)
+        fmt::print(stderr, ", sampled 1 in {}", sample_rate);
+
+    fmt::print(stderr, "\n");
+
+    std::size_t listed = 0;
+    for (const auto& [ptr, block] : blocks)
+    {
+        if (listed++ == max_leaks_listed)
+            break;
+
+        fmt::print(stderr, "  {} ({} bytes, alignment {})\n", ptr, block.bytes, block.alignment);
+    }
+
+    num_violations += blocks.size();
+    state.num_violations += blocks.size();
+}
+
+void* CheckedMemoryResource::do_allocate(std::size_t bytes, std::size_t alignment)
+{
+    void* const ptr = upstream->allocate(bytes, alignment);
+
+    // Resources that reset in bulk (such as monotonic buffers) may hand out an address that's
+    // still tracked, so replace rather than insert
+    if (sampled(ptr))
+        blocks[ptr] = {bytes, alignment};
+
+    return ptr;
+}
+
+void CheckedMemoryResource::do_deallocate(void* ptr, std::size_t bytes, std::size_t alignment)
+{
+    if (!sampled(ptr))
+    {
+        upstream->deallocate(ptr, bytes, alignment);
+        return;
+    }
+
+    const auto it = blocks.find(ptr);
+
+    if (it == blocks.end())
+    {
+        fmt::print(
+            stderr,
+            "invalid deallocate: {} ({} bytes, alignment {}) is not live, either freed twice or not allocated here\n",
+            ptr,
+            bytes,
+            alignment);
+
+        ++num_violations;
+        ++state.num_violations;
+        return;
+    }
+
+    const Block block = it->second;
+    blocks.erase(it);
+
+    if (block.bytes != bytes || block.alignment != alignment)
+    {
+        fmt::print(
+            stderr,
+            "mismatched deallocate: {} allocated with {} bytes, alignment {} but deallocated with {} bytes, alignment {}\n",
+            ptr,
+            block.bytes,
+            block.alignment,
+            bytes,
+            alignment);
+
+        ++num_violations;
+        ++state.num_violations;
+    }
+
+    upstream->deallocate(ptr, block.bytes, block.alignment);
+}
+
+std::size_t get_check_sample_rate() { return state.sample_rate; }
+void set_check_sample_rate(std::size_t sample_rate) { state.sample_rate = sample_rate; }
+
+std::size_t check_violations() { return state.num_violations; }
+
+} // namespace dr
@@ -0,0 +1,70 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory_resource>
+#include <unordered_map>
+
+namespace dr
+{
+
+// Sample rate of checked resources created from now on (0 disables checking)
+std::size_t get_check_sample_rate();
+void set_check_sample_rate(std::size_t sample_rate);
+
+// Forwards to upstream, checking that callers keep the memory_resource contract: each block is
+// deallocated once, with the size and alignment it was allocated with. Blocks still live when the
+// resource is destroyed are reported as leaks.
+//
+// Blocks are tracked in a side table rather than a header so the layout seen by upstream is
+// unchanged. With a sample rate of n, only blocks whose address hashes to 1 in n are tracked,
+// which keeps the cost low enough to leave on in load tests. Like DebugMemoryResource, this is
+// not thread safe.
+//
+// Violations are reported to stderr. Mismatched deallocations are forwarded with the size and
+// alignment of the allocation and invalid ones are dropped, so upstream is never corrupted.
+struct CheckedMemoryResource : public std::pmr::memory_resource
+{
+    struct Block
+    {
+        std::size_t bytes;
+        std::size_t alignment;
+    };
+
+    std::pmr::memory_resource* upstream;
+    std::size_t sample_rate;
+    std::unordered_map<void*, Block> blocks{};
+    std::size_t num_violations{};
+
+    // A sample rate of 0 (the default) disables checking
+    CheckedMemoryResource(std::pmr::memory_resource* upstream, std::size_t sample_rate = get_check_sample_rate());
+
+    CheckedMemoryResource(const CheckedMemoryResource&) = delete;
+    CheckedMemoryResource& operator=(const CheckedMemoryResource&) = delete;
+
+    // Reports leaks
+    ~CheckedMemoryResource();
+
+    bool sampled(const void* ptr) const
+    {
+        if (sample_rate <= 1)
+            return sample_rate == 1;
+
+        // Blocks are aligned, so mix the address before sampling
+        const std::uint64_t hash = reinterpret_cast<std::uintptr_t>(ptr) * 0x9e3779b97f4a7c15ull;
+        return (hash >> 32) % sample_rate == 0;
+    }
+
+    void* do_allocate(std::size_t bytes, std::size_t alignment) override;
+    void do_deallocate(void* ptr, std::size_t bytes, std::size_t alignment) override;
+
+    bool do_is_equal(const std::pmr::memory_resource& other) const noexcept override
+    {
+        return this == &other;
+    };
+};
+
+// Returns the number of violations found by all checked resources so far
+std::size_t check_violations();
+
+} // namespace dr
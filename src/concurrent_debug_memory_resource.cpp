@@ -0,0 +1,127 @@
+#include "concurrent_debug_memory_resource.hpp"
+
+#include <mutex>
+#include <vector>
+
+namespace dr
+{
+namespace
+{
+
+constexpr std::size_t shared_shard = ConcurrentDebugMemoryResource::num_shards - 1;
+
+struct
+{
+    std::mutex mutex{};
+    std::vector<std::size_t> free{};
+    std::size_t next{};
+} shard_indices;
+
+// Leases a shard index to the calling thread for its lifetime. Threads beyond the number of
+// exclusive shards all use the shared shard.
+struct ShardLease
+{
+    std::size_t index;
+
+    ShardLease()
+    {
+        std::lock_guard<std::mutex> lock{shard_indices.mutex};
+
+        if (!shard_indices.free.empty())
+        {
+            index = shard_indices.free.back();
+            shard_indices.free.pop_back();
+        }
+        else
+        {
+            index = shard_indices.next < shared_shard ? shard_indices.next++ : shared_shard;
+        }
+    }
+
+    ~ShardLease()
+    {
+        if (index == shared_shard) return;
+        std::lock_guard<std::mutex> lock{shard_indices.mutex};
+        shard_indices.free.push_back(index);
+    }
+};
+
+std::size_t shard_index()
+{
+    thread_local const ShardLease lease{};
+    return lease.index;
+}
+
+// Exclusive shards have a single writer so they can skip read-modify-write instructions
+template <typename T>
+void add(std::atomic<T>& counter, T value, bool exclusive)
+{
+    if (exclusive)
+        counter.store(counter.load(std::memory_order_relaxed) + value, std::memory_order_relaxed);
+    else
+        counter.fetch_add(value, std::memory_order_relaxed);
+}
+
+template <typename Func>
+auto sum_shards(const ConcurrentDebugMemoryResource& memory, Func&& func)
+{
+    decltype(func(memory.shards[0])) sum{};
+
+    for (auto& shard : memory.shards)
+        sum += func(shard);
+
+    return sum;
+}
+
+} // namespace
+
+std::size_t ConcurrentDebugMemoryResource::num_allocs() const
+{
+    return sum_shards(*this, [](const Shard& s) { return s.num_allocs.load(std::memory_order_relaxed); });
+}
+
+std::size_t ConcurrentDebugMemoryResource::num_deallocs() const
+{
+    return sum_shards(*this, [](const Shard& s) { return s.num_deallocs.load(std::memory_order_relaxed); });
+}
+
+std::size_t ConcurrentDebugMemoryResource::curr_bytes() const
+{
+    const std::ptrdiff_t sum = sum_shards(*this, [](const Shard& s) { return s.curr_bytes.load(std::memory_order_relaxed); });
+    return sum > 0 ? sum : 0;
+}
+
+std::size_t ConcurrentDebugMemoryResource::max_bytes() const
+{
+    return sum_shards(*this, [](const Shard& s) { return s.max_bytes.load(std::memory_order_relaxed); });
+}
+
+void* ConcurrentDebugMemoryResource::do_allocate(std::size_t bytes, std::size_t alignment)
+{
+    const std::size_t index = shard_index();
+    const bool exclusive = index != shared_shard;
+    Shard& shard = shards[index];
+
+    add<std::size_t>(shard.num_allocs, 1, exclusive);
+    add<std::ptrdiff_t>(shard.curr_bytes, bytes, exclusive);
+
+    const std::ptrdiff_t curr = shard.curr_bytes.load(std::memory_order_relaxed);
+    std::ptrdiff_t max = shard.max_bytes.load(std::memory_order_relaxed);
+    while (curr > max && !shard.max_bytes.compare_exchange_weak(max, curr, std::memory_order_relaxed)) {}
+
+    return upstream->allocate(bytes, alignment);
+}
+
+void ConcurrentDebugMemoryResource::do_deallocate(void* ptr, std::size_t bytes, std::size_t alignment)
+{
+    const std::size_t index = shard_index();
+    const bool exclusive = index != shared_shard;
+    Shard& shard = shards[index];
+
+    add<std::size_t>(shard.num_deallocs, 1, exclusive);
+    add<std::ptrdiff_t>(shard.curr_bytes, -std::ptrdiff_t(bytes), exclusive);
+
+    upstream->deallocate(ptr, bytes, alignment);
+}
+
+} // namespace dr
@@ -0,0 +1,48 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <memory_resource>
+
+namespace dr
+{
+
+// Thread-safe counterpart of DebugMemoryResource. Counters are sharded per thread (one cache
+// line per shard) and aggregated on read, so concurrent callers don't contend on a shared
+// counter.
+//
+// Note that max_bytes() is the sum of per-shard peaks. This is exact when a single thread
+// allocates and deallocates, and an upper bound on the true peak otherwise.
+struct ConcurrentDebugMemoryResource : public std::pmr::memory_resource
+{
+    static constexpr std::size_t num_shards = 64;
+
+    struct alignas(64) Shard
+    {
+        std::atomic<std::size_t> num_allocs{};
+        std::atomic<std::size_t> num_deallocs{};
+        std::atomic<std::ptrdiff_t> curr_bytes{};
+        std::atomic<std::ptrdiff_t> max_bytes{};
+    };
+
+    std::pmr::memory_resource* upstream;
+    Shard shards[num_shards]{};
+
+    ConcurrentDebugMemoryResource(std::pmr::memory_resource* upstream) :
+        upstream{upstream} {}
+
+    std::size_t num_allocs() const;
+    std::size_t num_deallocs() const;
+    std::size_t curr_bytes() const;
+    std::size_t max_bytes() const;
+
+    void* do_allocate(std::size_t bytes, std::size_t alignment) override;
+    void do_deallocate(void* ptr, std::size_t bytes, std::size_t alignment) override;
+
+    bool do_is_equal(const std::pmr::memory_resource& other) const noexcept override
+    {
+        return this == &other;
+    };
+};
+
+} // namespace dr
@@ -0,0 +1,116 @@
+#include "debug_memory_resource.hpp"
+
+#include <fmt/core.h>
+
+namespace dr
+{
+namespace
+{
+
+void print_histogram(const char* title, const char* prefix, const std::size_t (&counts)[DebugMemoryResource::num_buckets], std::size_t total)
+{
+    fmt::print("{}:\n", title);
+
+    for (std::size_t i = 0; i < DebugMemoryResource::num_buckets; ++i)
+    {
+        if (counts[i] == 0)
+            continue;
+
+        fmt::print(
+            "  {}{}: {} ({:.1f}%)\n",
+            prefix,
+            std::size_t{1} << i,
+            counts[i],
+            100.0 * counts[i] / total);
+    }
+}
+
+} // namespace
+
+void* DebugMemoryResource::do_allocate(std::size_t bytes, std::size_t alignment)
+{
+    ++num_allocs;
+    ++size_counts[size_bucket(bytes)];
+    ++alignment_counts[alignment_bucket(alignment)];
+
+    if (sampler != nullptr)
+        sampler->record(bytes);
+
+    curr_bytes += bytes;
+    if (curr_bytes > max_bytes) max_bytes = curr_bytes;
+
+    if (stats != nullptr)
+    {
+        const std::size_t bucket = size_bucket(bytes);
+
+        stats->begin_write();
+        stats->num_allocs.store(num_allocs, std::memory_order_relaxed);
+        stats->curr_bytes.store(curr_bytes, std::memory_order_relaxed);
+        stats->max_bytes.store(max_bytes, std::memory_order_relaxed);
+        stats->size_counts[bucket].store(size_counts[bucket], std::memory_order_relaxed);
+        stats->end_write();
+    }
+
+    void* const ptr = upstream->allocate(bytes, alignment);
+
+    if (heap_profiler != nullptr)
+        heap_profiler->on_allocate(ptr, bytes);
+
+    if (lifetimes != nullptr)
+        lifetimes->on_allocate(ptr, size_bucket(bytes));
+
+    return ptr;
+}
+
+void DebugMemoryResource::do_deallocate(void* ptr, std::size_t bytes, std::size_t alignment)
+{
+    ++num_deallocs;
+    curr_bytes -= bytes;
+
+    if (stats != nullptr)
+    {
+        stats->begin_write();
+        stats->num_deallocs.store(num_deallocs, std::memory_order_relaxed);
+        stats->curr_bytes.store(curr_bytes, std::memory_order_relaxed);
+        stats->end_write();
+    }
+
+    if (lifetimes != nullptr)
+        lifetimes->on_deallocate(ptr);
+
+    if (heap_profiler != nullptr)
+        heap_profiler->on_deallocate(ptr);
+
+    upstream->deallocate(ptr, bytes, alignment);
+}
+
+void print_histograms(const DebugMemoryResource& memory)
+{
+    if (memory.num_allocs == 0)
+        return;
+
+    print_histogram("sizes", "<= ", memory.size_counts, memory.num_allocs);
+    print_histogram("alignments", "", memory.alignment_counts, memory.num_allocs);
+}
+
+void print_utilization(std::size_t requested_bytes, std::size_t reserved_bytes)
+{
+    const std::size_t waste = reserved_bytes > requested_bytes ? reserved_bytes - requested_bytes : 0;
+
+    fmt::print("max requested bytes: {}\n", requested_bytes);
+    fmt::print("max reserved bytes: {}\n", reserved_bytes);
+
+    if (reserved_bytes > 0)
+        fmt::print("waste: {} bytes ({:.1f}%)\n", waste, 100.0 * waste / reserved_bytes);
+
+    if (requested_bytes > 0)
+        fmt::print("overhead ratio: {:.2f}\n", double(reserved_bytes) / requested_bytes);
+}
+
+void print_lifetimes(const DebugMemoryResource& memory)
+{
+    if (memory.lifetimes != nullptr)
+        memory.lifetimes->print();
+}
+
+} // namespace dr
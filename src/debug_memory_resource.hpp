@@ -0,0 +1,98 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <memory>
+#include <memory_resource>
+
+#include "heap_profiler.hpp"
+#include "lifetime_profiler.hpp"
+#include "stack_sampler.hpp"
+#include "stats_segment.hpp"
+
+namespace dr
+{
+
+// Whether a DebugMemoryResource reports to the stack sampler, heap profiler and stats publisher
+// installed when it's created. Resources below the one the tests allocate from turn this off, so
+// the chunks they hand out aren't mixed into profiles of the requests made by the tests.
+enum class Profiling
+{
+    off,
+    on,
+};
+
+// Forwards to upstream, counting allocations and bytes in use. Also keeps log2 histograms of
+// request sizes and alignments to show which block sizes dominate a workload. If a stack sampler
+// or heap profiler is installed when the resource is created, allocations are also attributed to
+// call stacks. If a stats publisher is installed, counters are published for external monitoring.
+struct DebugMemoryResource : public std::pmr::memory_resource
+{
+    static constexpr std::size_t num_buckets = 64;
+
+    std::pmr::memory_resource* upstream;
+    std::size_t num_allocs{};
+    std::size_t num_deallocs{};
+    std::size_t curr_bytes{};
+    std::size_t max_bytes{};
+
+    // Bucket i counts requests of size (2^(i-1), 2^i]
+    std::size_t size_counts[num_buckets]{};
+
+    // Bucket i counts requests with alignment 2^i
+    std::size_t alignment_counts[num_buckets]{};
+
+    StackSampler* sampler;
+    HeapProfiler* heap_profiler;
+
+    // Profiles block lifetimes if set
+    std::unique_ptr<LifetimeProfiler> lifetimes{};
+
+    StatsPublisher* publisher;
+    StatsSlot* stats{publisher != nullptr ? publisher->acquire() : nullptr};
+
+    DebugMemoryResource(std::pmr::memory_resource* upstream, Profiling profiling = Profiling::on) :
+        upstream{upstream},
+        sampler{profiling == Profiling::on ? get_stack_sampler() : nullptr},
+        heap_profiler{profiling == Profiling::on ? get_heap_profiler() : nullptr},
+        publisher{profiling == Profiling::on ? get_stats_publisher() : nullptr} {}
+
+    DebugMemoryResource(const DebugMemoryResource&) = delete;
+    DebugMemoryResource& operator=(const DebugMemoryResource&) = delete;
+
+    ~DebugMemoryResource()
+    {
+        if (stats != nullptr) publisher->release(stats);
+    }
+
+    static std::size_t size_bucket(std::size_t bytes)
+    {
+        // Sizes above 2^63 share the last bucket
+        return bytes > 1 ? std::min<std::size_t>(64 - __builtin_clzll(bytes - 1), num_buckets - 1) : 0;
+    }
+
+    static std::size_t alignment_bucket(std::size_t alignment)
+    {
+        return __builtin_ctzll(alignment);
+    }
+
+    void* do_allocate(std::size_t bytes, std::size_t alignment) override;
+    void do_deallocate(void* ptr, std::size_t bytes, std::size_t alignment) override;
+
+    bool do_is_equal(const std::pmr::memory_resource& other) const noexcept override
+    {
+        return this == &other;
+    };
+};
+
+// Prints the non-empty buckets of each histogram
+void print_histograms(const DebugMemoryResource& memory);
+
+// Prints peak bytes requested from a resource stack against peak bytes the stack reserved from
+// its upstream
+void print_utilization(std::size_t requested_bytes, std::size_t reserved_bytes);
+
+// Prints the lifetime summary if lifetimes were profiled
+void print_lifetimes(const DebugMemoryResource& memory);
+
+} // namespace dr
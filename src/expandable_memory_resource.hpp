@@ -0,0 +1,27 @@
+#pragma once
+
+#include <cstddef>
+#include <memory_resource>
+
+namespace dr
+{
+
+// Memory resource that can resize some allocations in place
+struct ExpandableMemoryResource : public std::pmr::memory_resource
+{
+    // Tries to resize the block at ptr from old_bytes to new_bytes without moving it. Returns
+    // false and leaves the block as is if that isn't possible. On success, the block must be
+    // deallocated with new_bytes.
+    bool try_expand(
+        void* ptr,
+        std::size_t old_bytes,
+        std::size_t new_bytes,
+        std::size_t alignment = alignof(std::max_align_t))
+    {
+        return do_try_expand(ptr, old_bytes, new_bytes, alignment);
+    }
+
+    virtual bool do_try_expand(void* ptr, std::size_t old_bytes, std::size_t new_bytes, std::size_t alignment) = 0;
+};
+
+} // namespace dr
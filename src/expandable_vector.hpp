@@ -0,0 +1,119 @@
+#pragma once
+
+#include <cstddef>
+#include <memory>
+#include <memory_resource>
+#include <new>
+#include <utility>
+
+#include "expandable_memory_resource.hpp"
+
+namespace dr
+{
+
+// Minimal vector on a polymorphic allocator. When the allocator's resource is an
+// ExpandableMemoryResource, the vector first tries to grow its storage in place and only falls
+// back to allocate-move-free if that fails.
+template <typename T>
+struct ExpandableVector
+{
+    using value_type = T;
+    using allocator_type = std::pmr::polymorphic_allocator<T>;
+
+    allocator_type allocator;
+    ExpandableMemoryResource* expandable;
+    T* items{};
+    std::size_t count{};
+    std::size_t cap{};
+
+    ExpandableVector(allocator_type allocator = {}) :
+        allocator{allocator},
+        expandable{dynamic_cast<ExpandableMemoryResource*>(allocator.resource())} {}
+
+    ExpandableVector(std::pmr::memory_resource* memory) :
+        ExpandableVector{allocator_type{memory}} {}
+
+    ExpandableVector(ExpandableVector&& other) noexcept :
+        allocator{other.allocator},
+        expandable{other.expandable},
+        items{std::exchange(other.items, nullptr)},
+        count{std::exchange(other.count, 0)},
+        cap{std::exchange(other.cap, 0)} {}
+
+    ExpandableVector(const ExpandableVector&) = delete;
+    ExpandableVector& operator=(const ExpandableVector&) = delete;
+
+    ~ExpandableVector()
+    {
+        clear();
+
+        if (items != nullptr)
+            allocator.deallocate(items, cap);
+    }
+
+    allocator_type get_allocator() const { return allocator; }
+
+    T* data() { return items; }
+    const T* data() const { return items; }
+
+    std::size_t size() const { return count; }
+    std::size_t capacity() const { return cap; }
+    bool empty() const { return count == 0; }
+
+    T* begin() { return items; }
+    T* end() { return items + count; }
+    const T* begin() const { return items; }
+    const T* end() const { return items + count; }
+
+    T& operator[](std::size_t index) { return items[index]; }
+    const T& operator[](std::size_t index) const { return items[index]; }
+
+    void reserve(std::size_t new_cap)
+    {
+        if (new_cap > cap)
+            grow(new_cap);
+    }
+
+    template <typename... Args>
+    T& emplace_back(Args&&... args)
+    {
+        if (count == cap)
+            grow(cap == 0 ? 1 : 2 * cap);
+
+        T* const item = ::new (static_cast<void*>(items + count)) T(std::forward<Args>(args)...);
+        ++count;
+        return *item;
+    }
+
+    void push_back(const T& value) { emplace_back(value); }
+    void push_back(T&& value) { emplace_back(std::move(value)); }
+
+    void clear()
+    {
+        std::destroy(items, items + count);
+        count = 0;
+    }
+
+  private:
+    void grow(std::size_t new_cap)
+    {
+        if (items != nullptr && expandable != nullptr &&
+            expandable->try_expand(items, cap * sizeof(T), new_cap * sizeof(T), alignof(T)))
+        {
+            cap = new_cap;
+            return;
+        }
+
+        T* const new_items = allocator.allocate(new_cap);
+        std::uninitialized_move(items, items + count, new_items);
+        std::destroy(items, items + count);
+
+        if (items != nullptr)
+            allocator.deallocate(items, cap);
+
+        items = new_items;
+        cap = new_cap;
+    }
+};
+
+} // namespace dr
@@ -0,0 +1,46 @@
+#pragma once
+
+#include <memory_resource>
+
+#include "arena_memory_resource.hpp"
+
+namespace dr
+{
+
+// Double-buffered frame allocator. Allocations go to the current frame. next_frame() makes the
+// older frame current and gives back everything allocated in it, so data allocated during one
+// frame stays valid through the next frame.
+//
+// Frames are arenas rewound to their start rather than released, so their chunks are reused
+// from frame to frame without going back to upstream.
+struct FrameMemoryResource : public std::pmr::memory_resource
+{
+    ArenaMemoryResource frames[2];
+    int curr{};
+
+    FrameMemoryResource(std::pmr::memory_resource* upstream) :
+        frames{{upstream}, {upstream}} {}
+
+    void next_frame()
+    {
+        curr ^= 1;
+        frames[curr].rewind({});
+    }
+
+    void* do_allocate(std::size_t bytes, std::size_t alignment) override
+    {
+        return frames[curr].allocate(bytes, alignment);
+    }
+
+    void do_deallocate(void* /*ptr*/, std::size_t /*bytes*/, std::size_t /*alignment*/) override
+    {
+        // Memory is given back a frame at a time
+    }
+
+    bool do_is_equal(const std::pmr::memory_resource& other) const noexcept override
+    {
+        return this == &other;
+    };
+};
+
+} // namespace dr
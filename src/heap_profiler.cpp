@@ -0,0 +1,172 @@
+#include "heap_profiler.hpp"
+
+#include <csignal>
+#include <cstdio>
+#include <string>
+
+#include <execinfo.h>
+
+#include <fmt/core.h>
+
+namespace dr
+{
+namespace
+{
+
+struct
+{
+    HeapProfiler* profiler{};
+
+    // Where profiles requested by signal are written, with the number of the dump appended
+    const char* dump_path{};
+    int num_dumps{};
+} state;
+
+// Set by the signal handler, which can't do more than that safely
+volatile std::sig_atomic_t dump_requested{};
+
+void request_dump(int /*signal*/)
+{
+    dump_requested = 1;
+}
+
+// Frames for sample() and the resource calling on_allocate()
+constexpr int skipped_frames = 2;
+
+// pprof needs the memory map to symbolize addresses
+bool copy_mapped_libraries(std::FILE* file)
+{
+    std::FILE* const maps = std::fopen("/proc/self/maps", "r");
+
+    if (maps == nullptr)
+        return false;
+
+    char buffer[4096];
+    std::size_t n{};
+
+    while ((n = std::fread(buffer, 1, sizeof(buffer), maps)) > 0)
+        std::fwrite(buffer, 1, n, file);
+
+    std::fclose(maps);
+    return true;
+}
+
+} // namespace
+
+HeapProfiler::HeapProfiler(std::size_t sample_period) :
+    sample_period{sample_period},
+    distribution{1.0 / sample_period},
+    countdown{static_cast<std::size_t>(distribution(random)) + 1} {}
+
+void HeapProfiler::sample(void* ptr, std::size_t bytes)
+{
+    countdown = static_cast<std::size_t>(distribution(random)) + 1;
+
+    // The address may still be tracked if a resource reset in bulk and handed it out again
+    forget(ptr);
+
+    void* frames[StackSampler::max_depth + skipped_frames];
+    const int depth = backtrace(frames, StackSampler::max_depth + skipped_frames);
+
+    if (depth <= skipped_frames)
+        return;
+
+    Stats& stats = stacks[std::vector<void*>(frames + skipped_frames, frames + depth)];
+    ++stats.alloc_count;
+    stats.alloc_bytes += bytes;
+    ++stats.inuse_count;
+    stats.inuse_bytes += bytes;
+
+    live[ptr] = {bytes, &stats};
+    ++filter[filter_index(ptr)];
+}
+
+void HeapProfiler::forget(void* ptr)
+{
+    const auto it = live.find(ptr);
+
+    if (it == live.end())
+        return;
+
+    --it->second.stats->inuse_count;
+    it->second.stats->inuse_bytes -= it->second.bytes;
+    --filter[filter_index(ptr)];
+    live.erase(it);
+}
+
+bool HeapProfiler::write(const char* path) const
+{
+    std::FILE* const file = std::fopen(path, "w");
+
+    if (file == nullptr)
+        return false;
+
+    Stats total{};
+
+    for (const auto& [frames, stats] : stacks)
+    {
+        total.alloc_count += stats.alloc_count;
+        total.alloc_bytes += stats.alloc_bytes;
+        total.inuse_count += stats.inuse_count;
+        total.inuse_bytes += stats.inuse_bytes;
+    }
+
+    fmt::print(
+        file,
+        "heap profile: {:6}: {:8} [{:6}: {:8}] @ heap_v2/{}\n",
+        total.inuse_count,
+        total.inuse_bytes,
+        total.alloc_count,
+        total.alloc_bytes,
+        sample_period);
+
+    for (const auto& [frames, stats] : stacks)
+    {
+        fmt::print(
+            file,
+            "{:6}: {:8} [{:6}: {:8}] @",
+            stats.inuse_count,
+            stats.inuse_bytes,
+            stats.alloc_count,
+            stats.alloc_bytes);
+
+        for (void* const frame : frames)
+            fmt::print(file, " {}", frame);
+
+        fmt::print(file, "\n");
+    }
+
+    fmt::print(file, "\nMAPPED_LIBRARIES:\n");
+    const bool copied = copy_mapped_libraries(file);
+
+    return std::fclose(file) == 0 && copied;
+}
+
+void dump_heap_profile_on_signal(const char* path)
+{
+    state.dump_path = path;
+    std::signal(SIGUSR1, request_dump);
+}
+
+void write_requested_heap_profile()
+{
+    if (dump_requested == 0)
+        return;
+
+    dump_requested = 0;
+
+    if (state.profiler == nullptr || state.dump_path == nullptr)
+        return;
+
+    const std::string path = fmt::format("{}.{}", state.dump_path, ++state.num_dumps);
+
+    if (state.profiler->write(path.c_str()))
+        fmt::print(stderr, "wrote heap profile {}\n", path);
+    else
+        fmt::print(stderr, "failed to write {}\n", path);
+}
+
+HeapProfiler* get_heap_profiler() { return state.profiler; }
+void set_heap_profiler(HeapProfiler* profiler) { state.profiler = profiler; }
+
+} // namespace dr
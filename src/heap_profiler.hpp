@@ -0,0 +1,101 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <random>
+#include <unordered_map>
+#include <vector>
+
+#include "stack_sampler.hpp"
+
+namespace dr
+{
+
+// Samples allocations with the call stack that made them, on average once every sample_period
+// bytes. As in tcmalloc, the distance to the next sample is drawn from an exponential distribution
+// so that sampling is a Poisson process over allocated bytes and larger blocks are more likely to
+// be sampled. Sampled blocks are kept until deallocated, so a profile shows both what is live and
+// what has been allocated so far.
+//
+// Profiles are written in the legacy gperftools heap format read by pprof, e.g.
+//
+//   pprof -sample_index=alloc_space -top pmr-eigen-test heap.prof
+//
+// pprof symbolizes the raw addresses itself and scales sampled counts back up using the period.
+struct HeapProfiler
+{
+    // Unsampled deallocations are skipped by a table of live samples per address hash, so most
+    // only pay for one load
+    static constexpr std::size_t filter_size = 4096;
+
+    struct Stats
+    {
+        std::size_t alloc_count{};
+        std::size_t alloc_bytes{};
+        std::size_t inuse_count{};
+        std::size_t inuse_bytes{};
+    };
+
+    struct Sample
+    {
+        std::size_t bytes;
+        Stats* stats;
+    };
+
+    std::size_t sample_period;
+    std::mt19937_64 random{};
+    std::exponential_distribution<double> distribution;
+    std::size_t countdown;
+
+    // Stats of each sampled stack, leaf first
+    std::unordered_map<std::vector<void*>, Stats, StackSampler::FramesHash> stacks{};
+
+    std::unordered_map<void*, Sample> live{};
+    std::uint32_t filter[filter_size]{};
+
+    HeapProfiler(std::size_t sample_period);
+
+    static std::size_t filter_index(const void* ptr)
+    {
+        const std::uint64_t hash = reinterpret_cast<std::uintptr_t>(ptr) * 0x9e3779b97f4a7c15ull;
+        return hash >> 52;
+    }
+
+    // Called by a resource on each allocation. Frames of the caller (i.e. the resource) are
+    // excluded from the recorded stack.
+    void on_allocate(void* ptr, std::size_t bytes)
+    {
+        if (bytes < countdown)
+            countdown -= bytes;
+        else
+            sample(ptr, bytes);
+    }
+
+    void on_deallocate(void* ptr)
+    {
+        if (filter[filter_index(ptr)] != 0)
+            forget(ptr);
+    }
+
+    // Writes the current profile. May be called at any time. Returns false if the file can't be
+    // written.
+    bool write(const char* path) const;
+
+  private:
+    void sample(void* ptr, std::size_t bytes);
+    void forget(void* ptr);
+};
+
+// Makes SIGUSR1 request a dump of the installed profile to "<path>.<n>", n counting dumps from 1,
+// so a long run can be inspected while it's going. The handler only sets a flag and the profile
+// is written by the next call to write_requested_heap_profile, which the benchmark harness makes
+// after each test.
+void dump_heap_profile_on_signal(const char* path);
+
+// Writes the installed profile if a dump was requested since the last call
+void write_requested_heap_profile();
+
+HeapProfiler* get_heap_profiler();
+void set_heap_profiler(HeapProfiler* profiler);
+
+} // namespace dr
@@ -0,0 +1,119 @@
+#include "huge_page_memory_resource.hpp"
+
+#include <cerrno>
+#include <cstdint>
+
+#include <sys/mman.h>
+#include <unistd.h>
+
+#ifndef MADV_POPULATE_WRITE
+#define MADV_POPULATE_WRITE 23 // Linux 5.14
+#endif
+
+namespace dr
+{
+namespace
+{
+
+constexpr int map_flags = MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE;
+constexpr int map_prot = PROT_READ | PROT_WRITE;
+
+std::size_t round_up(std::size_t value, std::size_t alignment)
+{
+    return (value + alignment - 1) & ~(alignment - 1);
+}
+
+// Reserves size bytes aligned to a huge page boundary so the kernel can back the whole region
+// with huge pages
+std::byte* reserve(std::size_t size)
+{
+    constexpr std::size_t align = HugePageMemoryResource::huge_page_size;
+
+    void* const ptr = mmap(nullptr, size + align, map_prot, map_flags, -1, 0);
+    if (ptr == MAP_FAILED)
+        return nullptr;
+
+    // Trim the unaligned head and the leftover tail
+    auto* const first = static_cast<std::byte*>(ptr);
+    auto* const aligned = reinterpret_cast<std::byte*>(round_up(reinterpret_cast<std::uintptr_t>(first), align));
+    if (aligned != first) munmap(first, aligned - first);
+    if (aligned + size != first + size + align) munmap(aligned + size, (first + size + align) - (aligned + size));
+
+    return aligned;
+}
+
+// Faults the region in. Returns false if that failed, or a failed remap left the region unmapped
+bool populate(std::byte* ptr, std::size_t size)
+{
+    // MAP_POPULATE would fault the region in before madvise could request huge pages, so prefer
+    // populating after the advice. Kernels without MADV_POPULATE_WRITE reject it with EINVAL and
+    // fall back to remapping with MAP_POPULATE, which only gets huge pages when THP is enabled
+    // system-wide. Any other error, such as ENOMEM, means the region couldn't be faulted in.
+    if (madvise(ptr, size, MADV_POPULATE_WRITE) == 0)
+        return true;
+
+    if (errno != EINVAL)
+        return false;
+
+    if (mmap(ptr, size, map_prot, map_flags | MAP_FIXED | MAP_POPULATE, -1, 0) == MAP_FAILED)
+        return false;
+
+    madvise(ptr, size, MADV_HUGEPAGE);
+    return true;
+}
+
+} // namespace
+
+HugePageMemoryResource::HugePageMemoryResource(
+    std::size_t capacity,
+    bool prefault,
+    std::pmr::memory_resource* upstream) :
+    upstream{upstream}
+{
+    const std::size_t size = round_up(capacity, huge_page_size);
+    base = top = size > 0 ? reserve(size) : nullptr;
+
+    if (base == nullptr)
+        return;
+
+    end = base + size;
+    madvise(base, size, MADV_HUGEPAGE);
+
+    // Without the arena every request goes to upstream
+    if (prefault && !populate(base, size))
+    {
+        munmap(base, size);
+        base = top = end = nullptr;
+    }
+}
+
+HugePageMemoryResource::~HugePageMemoryResource()
+{
+    if (base != nullptr)
+        munmap(base, end - base);
+}
+
+void* HugePageMemoryResource::do_allocate(std::size_t bytes, std::size_t alignment)
+{
+    auto* const ptr = reinterpret_cast<std::byte*>(round_up(reinterpret_cast<std::uintptr_t>(top), alignment));
+
+    if (base == nullptr || ptr > end || bytes > std::size_t(end - ptr))
+        return upstream->allocate(bytes, alignment);
+
+    top = ptr + bytes;
+    return ptr;
+}
+
+void HugePageMemoryResource::do_deallocate(void* ptr, std::size_t bytes, std::size_t alignment)
+{
+    if (!owns(ptr))
+    {
+        upstream->deallocate(ptr, bytes, alignment);
+        return;
+    }
+
+    if (static_cast<std::byte*>(ptr) + bytes == top)
+        top = static_cast<std::byte*>(ptr);
+}
+
+} // namespace dr
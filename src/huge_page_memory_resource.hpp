@@ -0,0 +1,48 @@
+#pragma once
+
+#include <cstddef>
+#include <memory_resource>
+
+namespace dr
+{
+
+// Bump allocator over a single mmap-reserved region that is advised to use transparent huge
+// pages. Intended as the upstream of a monotonic_buffer_resource or pool so that large arenas
+// are backed by 2 MiB pages instead of 4 KiB pages.
+//
+// Only the most recent allocation can be given back (its space is reused). Other deallocations
+// are ignored until destruction, when the whole region is unmapped. Requests that don't fit in
+// the remaining capacity go to upstream.
+struct HugePageMemoryResource : public std::pmr::memory_resource
+{
+    static constexpr std::size_t huge_page_size = 2 * 1024 * 1024;
+
+    std::pmr::memory_resource* upstream;
+    std::byte* base{};
+    std::byte* top{};
+    std::byte* end{};
+
+    // Reserves capacity bytes of address space (rounded up to whole huge pages). If prefault is
+    // true, the region is also populated up front so the allocating code takes no page faults.
+    HugePageMemoryResource(
+        std::size_t capacity,
+        bool prefault,
+        std::pmr::memory_resource* upstream = std::pmr::new_delete_resource());
+
+    HugePageMemoryResource(const HugePageMemoryResource&) = delete;
+    HugePageMemoryResource& operator=(const HugePageMemoryResource&) = delete;
+
+    ~HugePageMemoryResource();
+
+    bool owns(const void* ptr) const { return ptr >= base && ptr < end; }
+
+    void* do_allocate(std::size_t bytes, std::size_t alignment) override;
+    void do_deallocate(void* ptr, std::size_t bytes, std::size_t alignment) override;
+
+    bool do_is_equal(const std::pmr::memory_resource& other) const noexcept override
+    {
+        return this == &other;
+    };
+};
+
+} // namespace dr
@@ -0,0 +1,80 @@
+#pragma once
+
+#include <cstddef>
+#include <memory>
+#include <memory_resource>
+
+#include "expandable_memory_resource.hpp"
+
+namespace dr
+{
+
+// Bump allocator over an inline buffer of N bytes, intended to live on the stack alongside a
+// short-lived container. Requests that don't fit in the buffer go to upstream.
+//
+// Deallocation within the buffer is a no-op (except for the most recent allocation, whose space
+// is reused) so the buffer is only reclaimed when the resource goes out of scope. Likewise, only
+// the most recent allocation can grow in place.
+template <std::size_t N>
+struct InlineMemoryResource : public ExpandableMemoryResource
+{
+    std::pmr::memory_resource* upstream;
+    alignas(std::max_align_t) std::byte buffer[N];
+    std::byte* top{buffer};
+
+    InlineMemoryResource(std::pmr::memory_resource* upstream) :
+        upstream{upstream} {}
+
+    InlineMemoryResource(const InlineMemoryResource&) = delete;
+    InlineMemoryResource& operator=(const InlineMemoryResource&) = delete;
+
+    bool owns(const void* ptr) const { return ptr >= buffer && ptr < buffer + N; }
+
+    void* do_allocate(std::size_t bytes, std::size_t alignment) override
+    {
+        void* ptr = top;
+        std::size_t space = (buffer + N) - top;
+
+        if (std::align(alignment, bytes, ptr, space) == nullptr)
+            return upstream->allocate(bytes, alignment);
+
+        top = static_cast<std::byte*>(ptr) + bytes;
+        return ptr;
+    }
+
+    void do_deallocate(void* ptr, std::size_t bytes, std::size_t alignment) override
+    {
+        if (!owns(ptr))
+        {
+            upstream->deallocate(ptr, bytes, alignment);
+            return;
+        }
+
+        if (static_cast<std::byte*>(ptr) + bytes == top)
+            top = static_cast<std::byte*>(ptr);
+    }
+
+    bool do_try_expand(void* ptr, std::size_t old_bytes, std::size_t new_bytes, std::size_t /*alignment*/) override
+    {
+        if (!owns(ptr))
+            return false;
+
+        std::byte* const begin = static_cast<std::byte*>(ptr);
+
+        if (begin + old_bytes != top)
+            return new_bytes <= old_bytes;
+
+        if (new_bytes > std::size_t((buffer + N) - begin))
+            return false;
+
+        top = begin + new_bytes;
+        return true;
+    }
+
+    bool do_is_equal(const std::pmr::memory_resource& other) const noexcept override
+    {
+        return this == &other;
+    };
+};
+
+} // namespace dr
@@ -0,0 +1,46 @@
+#include "instrumentation.hpp"
+
+#include <fmt/format.h>
+
+#include "results.hpp"
+
+namespace dr
+{
+namespace
+{
+
+struct
+{
+    bool utilization{};
+} state;
+
+} // namespace
+
+Instrumentation::Instrumentation(std::pmr::memory_resource* resource) :
+    latency{resource},
+    checked{latency.enabled ? &latency : resource},
+    tracing{checked.sample_rate > 0 ? &checked : checked.upstream},
+    requested{tracing.tracer != nullptr ? &tracing : tracing.upstream},
+    top{&requested}
+{
+    const bool profiled = requested.sampler != nullptr || requested.heap_profiler != nullptr || requested.stats != nullptr;
+
+    if (!utilization && !profiled)
+        top = requested.upstream;
+
+    if (requested.stats != nullptr)
+        requested.stats->set_name(fmt::format("{} / requested", current_stack()).c_str());
+}
+
+void print_instrumentation(const Instrumentation& memory, const DebugMemoryResource& reserved)
+{
+    if (memory.utilization)
+        print_utilization(memory.requested.max_bytes, reserved.max_bytes);
+
+    print_latency(memory.latency);
+}
+
+bool utilization_metrics() { return state.utilization; }
+void set_utilization_metrics(bool enabled) { state.utilization = enabled; }
+
+} // namespace dr
@@ -0,0 +1,43 @@
+#pragma once
+
+#include <memory_resource>
+
+#include "checked_memory_resource.hpp"
+#include "debug_memory_resource.hpp"
+#include "latency_memory_resource.hpp"
+#include "tracing_memory_resource.hpp"
+
+namespace dr
+{
+
+// Whether instrumentation created from now on measures the bytes requested by the tests
+bool utilization_metrics();
+void set_utilization_metrics(bool enabled);
+
+// Wrappers around a resource under test: latency timing, contract checks, tracing and a
+// DebugMemoryResource counting requested bytes, which the stack sampler, heap profiler and stats
+// publisher report through. Only the wrappers enabled when it's created are chained on top of the
+// resource, so by default the tests allocate from the resource itself and timings don't include
+// instrumentation. The profiled layer is outermost, so sampled stacks start in the test code.
+struct Instrumentation
+{
+    bool utilization{utilization_metrics()};
+    LatencyMemoryResource latency;
+    CheckedMemoryResource checked;
+    TracingMemoryResource tracing;
+    DebugMemoryResource requested;
+
+    // Where the tests allocate from: the outermost wrapper in use, or the resource itself
+    std::pmr::memory_resource* top;
+
+    Instrumentation(std::pmr::memory_resource* resource);
+
+    Instrumentation(const Instrumentation&) = delete;
+    Instrumentation& operator=(const Instrumentation&) = delete;
+};
+
+// Prints what the instrumentation measured: requested bytes against reserved, which wraps the
+// upstream of the resource under test, and latency percentiles
+void print_instrumentation(const Instrumentation& memory, const DebugMemoryResource& reserved);
+
+} // namespace dr
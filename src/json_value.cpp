@@ -0,0 +1,248 @@
+#include "json_value.hpp"
+
+#include <charconv>
+#include <cstdio>
+
+namespace dr
+{
+namespace
+{
+
+// Deeper documents are rejected rather than overflowing the stack
+constexpr int max_depth = 64;
+
+struct Parser
+{
+    std::string_view text;
+    std::size_t pos{};
+
+    void skip_space()
+    {
+        while (pos < text.size() && (text[pos] == ' ' || text[pos] == '\t' || text[pos] == '\n' || text[pos] == '\r'))
+            ++pos;
+    }
+
+    bool consume(char c)
+    {
+        skip_space();
+
+        if (pos >= text.size() || text[pos] != c)
+            return false;
+
+        ++pos;
+        return true;
+    }
+
+    bool consume_word(std::string_view word)
+    {
+        if (text.compare(pos, word.size(), word) != 0)
+            return false;
+
+        pos += word.size();
+        return true;
+    }
+
+    // Code points beyond ASCII are encoded as UTF-8. Surrogate pairs aren't combined.
+    static void append_utf8(std::string& result, unsigned code)
+    {
+        if (code < 0x80)
+        {
+            result += static_cast<char>(code);
+        }
+        else if (code < 0x800)
+        {
+            result += static_cast<char>(0xc0 | (code >> 6));
+            result += static_cast<char>(0x80 | (code & 0x3f));
+        }
+        else
+        {
+            result += static_cast<char>(0xe0 | (code >> 12));
+            result += static_cast<char>(0x80 | ((code >> 6) & 0x3f));
+            result += static_cast<char>(0x80 | (code & 0x3f));
+        }
+    }
+
+    bool parse_string(std::string& result)
+    {
+        if (!consume('"'))
+            return false;
+
+        while (pos < text.size())
+        {
+            const char c = text[pos++];
+
+            if (c == '"')
+                return true;
+
+            if (c != '\\')
+            {
+                result += c;
+                continue;
+            }
+
+            if (pos >= text.size())
+                return false;
+
+            switch (const char escape = text[pos++])
+            {
+            case '"':
+            case '\\':
+            case '/':
+                result += escape;
+                break;
+            case 'b':
+                result += '\b';
+                break;
+            case 'f':
+                result += '\f';
+                break;
+            case 'n':
+                result += '\n';
+                break;
+            case 'r':
+                result += '\r';
+                break;
+            case 't':
+                result += '\t';
+                break;
+            case 'u':
+            {
+                unsigned code{};
+                const char* const first = text.data() + pos;
+
+                if (pos + 4 > text.size() || std::from_chars(first, first + 4, code, 16).ptr != first + 4)
+                    return false;
+
+                append_utf8(result, code);
+                pos += 4;
+                break;
+            }
+            default:
+                return false;
+            }
+        }
+
+        return false;
+    }
+
+    bool parse_number(double& result)
+    {
+        const char* const first = text.data() + pos;
+        const auto [end, error] = std::from_chars(first, text.data() + text.size(), result);
+
+        if (error != std::errc{})
+            return false;
+
+        pos += end - first;
+        return true;
+    }
+
+    bool parse_value(JsonValue& result, int depth)
+    {
+        skip_space();
+
+        if (pos >= text.size() || depth > max_depth)
+            return false;
+
+        switch (text[pos])
+        {
+        case '{':
+            result.type = JsonValue::Type::object;
+            ++pos;
+
+            if (consume('}'))
+                return true;
+
+            do
+            {
+                result.keys.emplace_back();
+                result.items.emplace_back();
+
+                if (!parse_string(result.keys.back()) || !consume(':') || !parse_value(result.items.back(), depth + 1))
+                    return false;
+            } while (consume(','));
+
+            return consume('}');
+
+        case '[':
+            result.type = JsonValue::Type::array;
+            ++pos;
+
+            if (consume(']'))
+                return true;
+
+            do
+            {
+                result.items.emplace_back();
+
+                if (!parse_value(result.items.back(), depth + 1))
+                    return false;
+            } while (consume(','));
+
+            return consume(']');
+
+        case '"':
+            result.type = JsonValue::Type::string;
+            return parse_string(result.string);
+
+        case 't':
+            result.type = JsonValue::Type::boolean;
+            result.boolean = true;
+            return consume_word("true");
+
+        case 'f':
+            result.type = JsonValue::Type::boolean;
+            return consume_word("false");
+
+        case 'n':
+            return consume_word("null");
+
+        default:
+            result.type = JsonValue::Type::number;
+            return parse_number(result.number);
+        }
+    }
+};
+
+} // namespace
+
+const JsonValue* JsonValue::find(std::string_view key) const
+{
+    for (std::size_t i = 0; i < keys.size(); ++i)
+    {
+        if (keys[i] == key)
+            return &items[i];
+    }
+
+    return nullptr;
+}
+
+bool parse_json(std::string_view text, JsonValue& result)
+{
+    Parser parser{text};
+
+    if (!parser.parse_value(result, 0))
+        return false;
+
+    parser.skip_space();
+    return parser.pos == text.size();
+}
+
+bool read_json(const char* path, JsonValue& result)
+{
+    std::FILE* const file = std::fopen(path, "rb");
+
+    if (file == nullptr)
+        return false;
+
+    std::string text{};
+    char chunk[64 * 1024];
+
+    for (std::size_t n; (n = std::fread(chunk, 1, sizeof(chunk), file)) > 0;)
+        text.append(chunk, n);
+
+    std::fclose(file);
+    return parse_json(text, result);
+}
+
+} // namespace dr
@@ -0,0 +1,43 @@
+#pragma once
+
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace dr
+{
+
+// Parsed JSON value. Enough to read back the results written by write_json, not a general purpose
+// library: numbers are doubles and objects keep their keys in document order.
+struct JsonValue
+{
+    enum class Type
+    {
+        null,
+        boolean,
+        number,
+        string,
+        array,
+        object,
+    };
+
+    Type type{Type::null};
+    bool boolean{};
+    double number{};
+    std::string string{};
+
+    // Elements of an array, or values of an object's members with their keys in keys
+    std::vector<JsonValue> items{};
+    std::vector<std::string> keys{};
+
+    // Returns the value of the member with the given key, or null if there isn't one
+    const JsonValue* find(std::string_view key) const;
+};
+
+// Parses a JSON document. Returns false if it's malformed.
+bool parse_json(std::string_view text, JsonValue& result);
+
+// Reads and parses a JSON file. Returns false if it can't be read or is malformed.
+bool read_json(const char* path, JsonValue& result);
+
+} // namespace dr
@@ -0,0 +1,95 @@
+#include "latency_memory_resource.hpp"
+
+#include <fmt/core.h>
+
+namespace dr
+{
+namespace
+{
+
+struct
+{
+    bool enabled{};
+} state;
+
+double calibrate()
+{
+#if defined(__x86_64__) || defined(__i386__)
+    using Clock = std::chrono::steady_clock;
+
+    // Spin for long enough that clock resolution doesn't matter
+    const auto start = Clock::now();
+    const std::uint64_t start_ticks = read_ticks();
+
+    while (Clock::now() - start < std::chrono::milliseconds{20})
+    {
+    }
+
+    const std::uint64_t ticks = read_ticks() - start_ticks;
+    const auto ns = std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - start).count();
+    return double(ticks) / ns;
+#else
+    return 1.0;
+#endif
+}
+
+void print_histogram(const char* name, const LatencyHistogram& histogram)
+{
+    if (histogram.total == 0)
+        return;
+
+    const double scale = 1.0 / ticks_per_ns();
+
+    fmt::print(
+        "{} latency: p50 {:.0f} ns, p99 {:.0f} ns, p99.9 {:.0f} ns, max {:.0f} ns\n",
+        name,
+        histogram.percentile(50.0) * scale,
+        histogram.percentile(99.0) * scale,
+        histogram.percentile(99.9) * scale,
+        histogram.max * scale);
+}
+
+} // namespace
+
+double ticks_per_ns()
+{
+    static const double result = calibrate();
+    return result;
+}
+
+std::uint64_t LatencyHistogram::percentile(double p) const
+{
+    const double rank = p / 100.0 * total;
+    std::uint64_t count = 0;
+
+    for (std::size_t i = 0; i < num_buckets; ++i)
+    {
+        count += counts[i];
+
+        if (count > 0 && count >= rank)
+            return std::min(bucket_max(i), max);
+    }
+
+    return max;
+}
+
+LatencyMemoryResource::LatencyMemoryResource(std::pmr::memory_resource* upstream) :
+    upstream{upstream}, enabled{latency_timing()}
+{
+    // Calibrate up front rather than during the first report
+    if (enabled) ticks_per_ns();
+}
+
+bool latency_timing() { return state.enabled; }
+void set_latency_timing(bool enabled) { state.enabled = enabled; }
+
+void print_latency(const LatencyMemoryResource& memory)
+{
+    if (!memory.enabled)
+        return;
+
+    print_histogram("allocate", memory.allocs);
+    print_histogram("deallocate", memory.deallocs);
+}
+
+} // namespace dr
@@ -0,0 +1,119 @@
+#pragma once
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <memory_resource>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+
+namespace dr
+{
+
+// Reads the time stamp counter where available, or a steady clock in nanoseconds otherwise
+inline std::uint64_t read_ticks()
+{
+#if defined(__x86_64__) || defined(__i386__)
+    return __rdtsc();
+#else
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+#endif
+}
+
+// Ticks per nanosecond, calibrated against a steady clock on first use
+double ticks_per_ns();
+
+// Log-linear histogram in the style of HdrHistogram. Values below 2^sub_bucket_bits are counted
+// exactly and larger values are counted with a relative error of at most 2^-sub_bucket_bits.
+struct LatencyHistogram
+{
+    static constexpr int sub_bucket_bits = 5;
+    static constexpr std::size_t sub_buckets = std::size_t{1} << sub_bucket_bits;
+    static constexpr std::size_t num_buckets = (64 - sub_bucket_bits + 1) * sub_buckets;
+
+    std::uint64_t counts[num_buckets]{};
+    std::uint64_t total{};
+    std::uint64_t max{};
+
+    static std::size_t bucket(std::uint64_t value)
+    {
+        if (value < sub_buckets)
+            return value;
+
+        const int shift = 63 - __builtin_clzll(value) - sub_bucket_bits;
+        return (shift + 1) * sub_buckets + ((value >> shift) - sub_buckets);
+    }
+
+    // Returns the largest value counted by the given bucket
+    static std::uint64_t bucket_max(std::size_t index)
+    {
+        if (index < sub_buckets)
+            return index;
+
+        const std::size_t shift = index / sub_buckets - 1;
+        return (((index % sub_buckets + sub_buckets) + 1) << shift) - 1;
+    }
+
+    void record(std::uint64_t value)
+    {
+        ++counts[bucket(value)];
+        ++total;
+        if (value > max) max = value;
+    }
+
+    // Returns an upper bound on the value at the given percentile (0-100)
+    std::uint64_t percentile(double p) const;
+};
+
+// Forwards to upstream, timing each allocate and deallocate. Timing is only enabled if latency
+// timing was on when the resource was created, otherwise calls are forwarded as is.
+struct LatencyMemoryResource : public std::pmr::memory_resource
+{
+    std::pmr::memory_resource* upstream;
+    bool enabled;
+    LatencyHistogram allocs{};
+    LatencyHistogram deallocs{};
+
+    LatencyMemoryResource(std::pmr::memory_resource* upstream);
+
+    void* do_allocate(std::size_t bytes, std::size_t alignment) override
+    {
+        if (!enabled)
+            return upstream->allocate(bytes, alignment);
+
+        const std::uint64_t start = read_ticks();
+        void* const ptr = upstream->allocate(bytes, alignment);
+        allocs.record(read_ticks() - start);
+        return ptr;
+    }
+
+    void do_deallocate(void* ptr, std::size_t bytes, std::size_t alignment) override
+    {
+        if (!enabled)
+        {
+            upstream->deallocate(ptr, bytes, alignment);
+            return;
+        }
+
+        const std::uint64_t start = read_ticks();
+        upstream->deallocate(ptr, bytes, alignment);
+        deallocs.record(read_ticks() - start);
+    }
+
+    bool do_is_equal(const std::pmr::memory_resource& other) const noexcept override
+    {
+        return this == &other;
+    };
+};
+
+// Whether latency resources created from now on time calls
+bool latency_timing();
+void set_latency_timing(bool enabled);
+
+// Prints latency percentiles in nanoseconds if the resource was timing calls
+void print_latency(const LatencyMemoryResource& memory);
+
+} // namespace dr
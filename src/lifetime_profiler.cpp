@@ -0,0 +1,185 @@
+#include "lifetime_profiler.hpp"
+
+#include <fmt/core.h>
+
+namespace dr
+{
+namespace
+{
+
+// Percentage required before recommending a resource for a pattern
+constexpr double threshold = 90.0;
+
+// Size of the largest class served by the pool resources
+constexpr std::size_t max_pool_block = 4096;
+
+std::size_t log2_bucket(std::size_t n)
+{
+    return n > 1 ? 64 - __builtin_clzll(n - 1) : 0;
+}
+
+// Returns the upper bound of the bucket holding the median
+std::size_t median(const std::size_t (&counts)[LifetimeProfiler::num_buckets], std::size_t total)
+{
+    std::size_t sum = 0;
+
+    for (std::size_t i = 0; i < LifetimeProfiler::num_buckets; ++i)
+    {
+        sum += counts[i];
+        if (2 * sum >= total) return std::size_t{1} << i;
+    }
+
+    return 0;
+}
+
+double percent(std::size_t n, std::size_t total)
+{
+    return total > 0 ? 100.0 * n / total : 0.0;
+}
+
+} // namespace
+
+void LifetimeProfiler::on_allocate(void* ptr, std::size_t size_class)
+{
+    if (!free_run.empty())
+        end_free_run();
+
+    ++classes[size_class].blocks;
+    live[ptr] = {live_order.size(), num_allocs++, Clock::now(), size_class};
+    live_order.push_back(ptr);
+}
+
+void LifetimeProfiler::on_deallocate(void* ptr)
+{
+    const auto it = live.find(ptr);
+
+    if (it == live.end())
+        return;
+
+    const Live block = it->second;
+    live.erase(it);
+
+    SizeClass& c = classes[block.size_class];
+    ++c.frees;
+    ++c.allocs_lived[log2_bucket(num_allocs - block.alloc_index)];
+
+    const auto ns = std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - block.time).count();
+    ++c.ns_lived[log2_bucket(static_cast<std::size_t>(ns))];
+
+    if (block.order + 1 == live_order.size())
+    {
+        ++c.lifo_frees;
+        live_order.pop_back();
+
+        while (!live_order.empty() && live_order.back() == nullptr)
+            live_order.pop_back();
+    }
+    else
+    {
+        live_order[block.order] = nullptr;
+
+        // Every entry that isn't null is a live block, so this is the number of nulls
+        if (2 * (live_order.size() - live.size()) > live_order.size())
+            compact_live_order();
+    }
+
+    free_run.push_back(block.size_class);
+}
+
+void LifetimeProfiler::compact_live_order()
+{
+    std::size_t n = 0;
+
+    for (void* const ptr : live_order)
+    {
+        if (ptr == nullptr)
+            continue;
+
+        live[ptr].order = n;
+        live_order[n++] = ptr;
+    }
+
+    live_order.resize(n);
+}
+
+void LifetimeProfiler::end_free_run()
+{
+    if (free_run.size() >= min_batch)
+    {
+        for (const std::size_t size_class : free_run)
+            ++classes[size_class].batched_frees;
+    }
+
+    free_run.clear();
+}
+
+void LifetimeProfiler::print() const
+{
+    // Count the trailing run of frees without modifying the profile
+    std::size_t pending[num_buckets]{};
+
+    if (free_run.size() >= min_batch)
+    {
+        for (const std::size_t size_class : free_run)
+            ++pending[size_class];
+    }
+
+    std::size_t blocks = 0;
+    std::size_t frees = 0;
+    std::size_t lifo_frees = 0;
+    std::size_t batched_frees = 0;
+    std::size_t replaced_frees = 0;
+    std::size_t small_blocks = 0;
+
+    fmt::print("lifetimes:\n");
+
+    for (std::size_t i = 0; i < num_buckets; ++i)
+    {
+        const SizeClass& c = classes[i];
+
+        if (c.blocks == 0)
+            continue;
+
+        const std::size_t batched = c.batched_frees + pending[i];
+
+        fmt::print(
+            "  <= {}: {} blocks, {:.1f}% lifo, {:.1f}% batched, median <= {} allocs, <= {} ns\n",
+            std::size_t{1} << i,
+            c.blocks,
+            percent(c.lifo_frees, c.frees),
+            percent(batched, c.frees),
+            median(c.allocs_lived, c.frees),
+            median(c.ns_lived, c.frees));
+
+        blocks += c.blocks;
+        frees += c.frees;
+        lifo_frees += c.lifo_frees;
+        batched_frees += batched;
+        if ((std::size_t{1} << i) <= max_pool_block) small_blocks += c.blocks;
+
+        // Bucket 1 holds blocks freed after exactly one more allocation, e.g. a container's old
+        // storage once it has grown
+        replaced_frees += c.allocs_lived[1];
+    }
+
+    if (frees == 0)
+        return;
+
+    const double lifo = percent(lifo_frees, frees);
+    const double batched = percent(batched_frees, frees);
+    const double replaced = percent(replaced_frees, frees);
+    const double small = percent(small_blocks, blocks);
+
+    if (lifo >= threshold)
+        fmt::print("recommendation: {:.0f}% of blocks die in LIFO order, so use an arena\n", lifo);
+    else if (replaced >= threshold)
+        fmt::print("recommendation: {:.0f}% of blocks die right after the next allocation, so reserve capacity or grow in place\n", replaced);
+    else if (batched >= threshold)
+        fmt::print("recommendation: {:.0f}% of blocks die together in batches, so use a monotonic buffer\n", batched);
+    else if (small >= threshold)
+        fmt::print("recommendation: {:.0f}% of blocks die out of order but fit a pool size class, so use a pool\n", small);
+    else
+        fmt::print("recommendation: lifetimes and sizes are mixed, so use a general purpose resource such as TLSF\n");
+}
+
+} // namespace dr
@@ -0,0 +1,71 @@
+#pragma once
+
+#include <chrono>
+#include <cstddef>
+#include <unordered_map>
+#include <vector>
+
+namespace dr
+{
+
+// Tracks how long each block lives, in time and in allocations made while it's live, and
+// summarizes lifetimes per size class. The summary ends with a recommendation for the kind of
+// resource that suits the observed pattern.
+struct LifetimeProfiler
+{
+    static constexpr std::size_t num_buckets = 64;
+
+    // Frees in a run at least this long (with no allocation in between) count as batched
+    static constexpr std::size_t min_batch = 8;
+
+    using Clock = std::chrono::steady_clock;
+
+    struct Live
+    {
+        std::size_t order;
+        std::size_t alloc_index;
+        Clock::time_point time;
+        std::size_t size_class;
+    };
+
+    struct SizeClass
+    {
+        std::size_t blocks{};
+        std::size_t frees{};
+
+        // Frees of the most recently allocated live block
+        std::size_t lifo_frees{};
+
+        // Frees in a run of at least min_batch
+        std::size_t batched_frees{};
+
+        // Bucket i counts lifetimes of (2^(i-1), 2^i] allocations or nanoseconds
+        std::size_t allocs_lived[num_buckets]{};
+        std::size_t ns_lived[num_buckets]{};
+    };
+
+    // Indexed by log2 size bucket as in DebugMemoryResource
+    SizeClass classes[num_buckets]{};
+
+    std::unordered_map<void*, Live> live{};
+
+    // Live blocks in allocation order. Blocks freed out of order leave a null behind, and the
+    // nulls are squeezed out once they make up more than half of the list.
+    std::vector<void*> live_order{};
+
+    // Size classes of the frees since the last allocation
+    std::vector<std::size_t> free_run{};
+
+    std::size_t num_allocs{};
+
+    void on_allocate(void* ptr, std::size_t size_class);
+    void on_deallocate(void* ptr);
+
+    void print() const;
+
+  private:
+    void compact_live_order();
+    void end_free_run();
+};
+
+} // namespace dr
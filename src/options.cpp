@@ -0,0 +1,162 @@
+#include "options.hpp"
+
+#include <charconv>
+#include <cstdlib>
+#include <string_view>
+
+#include <fmt/core.h>
+
+namespace dr
+{
+namespace
+{
+
+[[noreturn]] void usage(const char* program, int status)
+{
+    fmt::print(
+        stderr,
+        "usage: {} [options]\n"
+        "\n"
+        "options:\n"
+        "  --stacks <globs>      run resource stacks matching comma-separated globs\n"
+        "  --tests <globs>       run tests matching comma-separated globs\n"
+        "  --json <path>         write benchmark results and host metadata as JSON\n"
+        "  --csv <path>          write benchmark results and host metadata as CSV\n"
+        "  --sweep               run the sized tests at each size of a sweep instead\n"
+        "  --sizes <n,...>       sweep these sizes instead of the default\n"
+        "  --huge-pages          compare buffer resources backed by huge page arenas\n"
+        "  --folded <path>       write sampled allocation stacks for flamegraph tools\n"
+        "  --sample-allocs <n>   sample stacks every n allocations (default 100)\n"
+        "  --sample-bytes <n>    sample stacks every n bytes instead\n"
+        "  --heap-profile <path> write a sampled heap profile for pprof\n"
+        "  --heap-sample-bytes <n>\n"
+        "                        sample the heap every n bytes on average (default 524288)\n"
+        "  --trace <path>        write allocation events as Chrome trace JSON\n"
+        "  --stats               publish live counters to shared memory for pmr-top\n"
+        "  --record <path>       record allocations of each test for pmr-replay instead\n"
+        "  --lifetimes           profile block lifetimes of each test instead\n"
+        "  --perf                count CPU events of each test with perf_event_open\n"
+        "  --utilization         report requested vs reserved bytes of each resource stack\n"
+        "  --latency             report allocate/deallocate latency percentiles\n"
+        "  --check <n>           check deallocations of 1 in n blocks (1 checks all)\n"
+        "  --help                show this message\n",
+        program);
+
+    std::exit(status);
+}
+
+// Returns the value following the option at i, exiting if there isn't one
+const char* option_value(int argc, char* argv[], int& i)
+{
+    if (i + 1 >= argc)
+        usage(argv[0], EXIT_FAILURE);
+
+    return argv[++i];
+}
+
+// Parses a positive count, exiting if it's invalid
+std::size_t option_count(int argc, char* argv[], int& i)
+{
+    const std::string_view value{option_value(argc, argv, i)};
+    std::size_t result{};
+    const auto [end, error] = std::from_chars(value.data(), value.data() + value.size(), result);
+
+    if (error != std::errc{} || end != value.data() + value.size() || result == 0)
+        usage(argv[0], EXIT_FAILURE);
+
+    return result;
+}
+
+// Parses a comma-separated list of positive sizes, exiting if any is invalid
+std::vector<int> option_sizes(int argc, char* argv[], int& i)
+{
+    std::string_view rest{option_value(argc, argv, i)};
+    std::vector<int> result{};
+
+    while (true)
+    {
+        const std::string_view value = rest.substr(0, rest.find(','));
+        int size{};
+        const auto [end, error] = std::from_chars(value.data(), value.data() + value.size(), size);
+
+        if (error != std::errc{} || end != value.data() + value.size() || size <= 0)
+            usage(argv[0], EXIT_FAILURE);
+
+        result.push_back(size);
+
+        if (value.size() == rest.size())
+            return result;
+
+        rest.remove_prefix(value.size() + 1);
+    }
+}
+
+} // namespace
+
+Options parse_options(int argc, char* argv[])
+{
+    Options result{};
+
+    for (int i = 1; i < argc; ++i)
+    {
+        const std::string_view arg{argv[i]};
+
+        if (arg == "--stacks")
+            result.stacks = option_value(argc, argv, i);
+        else if (arg == "--tests")
+            result.tests = option_value(argc, argv, i);
+        else if (arg == "--json")
+            result.json = option_value(argc, argv, i);
+        else if (arg == "--csv")
+            result.csv = option_value(argc, argv, i);
+        else if (arg == "--sweep")
+            result.sweep = true;
+        else if (arg == "--sizes")
+        {
+            result.sweep = true;
+            result.sizes = option_sizes(argc, argv, i);
+        }
+        else if (arg == "--huge-pages")
+            result.huge_pages = true;
+        else if (arg == "--folded")
+            result.folded = option_value(argc, argv, i);
+        else if (arg == "--sample-allocs")
+        {
+            result.sample_bytes = false;
+            result.sample_interval = option_count(argc, argv, i);
+        }
+        else if (arg == "--sample-bytes")
+        {
+            result.sample_bytes = true;
+            result.sample_interval = option_count(argc, argv, i);
+        }
+        else if (arg == "--heap-profile")
+            result.heap_profile = option_value(argc, argv, i);
+        else if (arg == "--heap-sample-bytes")
+            result.heap_sample_bytes = option_count(argc, argv, i);
+        else if (arg == "--trace")
+            result.trace = option_value(argc, argv, i);
+        else if (arg == "--stats")
+            result.stats = true;
+        else if (arg == "--record")
+            result.record = option_value(argc, argv, i);
+        else if (arg == "--lifetimes")
+            result.lifetimes = true;
+        else if (arg == "--perf")
+            result.perf = true;
+        else if (arg == "--utilization")
+            result.utilization = true;
+        else if (arg == "--latency")
+            result.latency = true;
+        else if (arg == "--check")
+            result.check_sample_rate = option_count(argc, argv, i);
+        else if (arg == "--help")
+            usage(argv[0], EXIT_SUCCESS);
+        else
+            usage(argv[0], EXIT_FAILURE);
+    }
+
+    return result;
+}
+
+} // namespace dr
@@ -0,0 +1,66 @@
+#pragma once
+
+#include <cstddef>
+#include <vector>
+
+namespace dr
+{
+
+// Command line options shared by the test executables
+struct Options
+{
+    // Comma-separated globs selecting resource stacks and tests (all by default)
+    const char* stacks{};
+    const char* tests{};
+
+    // If set, benchmark results are written to these paths
+    const char* json{};
+    const char* csv{};
+
+    // Run the sized tests once for each size, using the default sweep if sizes is empty
+    bool sweep{};
+    std::vector<int> sizes{};
+
+    // Compare buffer resource stacks backed by huge page arenas
+    bool huge_pages{};
+
+    // If set, sampled allocation stacks are written to this path in folded format
+    const char* folded{};
+
+    // Sample every sample_interval bytes rather than every sample_interval allocations
+    bool sample_bytes{};
+    std::size_t sample_interval{100};
+
+    // If set, a heap profile sampled every heap_sample_bytes on average is written to this path
+    const char* heap_profile{};
+    std::size_t heap_sample_bytes{512 * 1024};
+
+    // Publish live counters of each resource to shared memory for pmr-top
+    bool stats{};
+
+    // If set, allocation events are written to this path as Chrome trace JSON
+    const char* trace{};
+
+    // If set, each test runs once and its allocations are recorded to this path for pmr-replay
+    const char* record{};
+
+    // Profile block lifetimes of each test and recommend a resource for it
+    bool lifetimes{};
+
+    // Count cycles, instructions, cache misses etc. of each test with perf_event_open
+    bool perf{};
+
+    // Report bytes requested by the tests against bytes reserved from upstream per resource stack
+    bool utilization{};
+
+    // Time each allocate and deallocate and report latency percentiles per resource stack
+    bool latency{};
+
+    // Check the deallocation contract of 1 in check_sample_rate blocks per resource stack (0 is off)
+    std::size_t check_sample_rate{};
+};
+
+// Prints usage and exits if the arguments are invalid
+Options parse_options(int argc, char* argv[]);
+
+} // namespace dr
@@ -0,0 +1,178 @@
+#include "perf_counters.hpp"
+
+#include <cerrno>
+#include <cstdint>
+#include <cstring>
+
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+namespace dr
+{
+namespace
+{
+
+struct
+{
+    PerfCounters* counters{};
+} state;
+
+struct Event
+{
+    std::uint32_t type;
+    std::uint64_t config;
+};
+
+constexpr std::uint64_t cache_miss(std::uint64_t cache)
+{
+    return cache | (PERF_COUNT_HW_CACHE_OP_READ << 8) | (PERF_COUNT_HW_CACHE_RESULT_MISS << 16);
+}
+
+// In the order of PerfCounters::names
+constexpr Event events[PerfCounters::num_events] = {
+    {PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES},
+    {PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS},
+    {PERF_TYPE_HW_CACHE, cache_miss(PERF_COUNT_HW_CACHE_L1D)},
+    {PERF_TYPE_HW_CACHE, cache_miss(PERF_COUNT_HW_CACHE_LL)},
+    {PERF_TYPE_HW_CACHE, cache_miss(PERF_COUNT_HW_CACHE_DTLB)},
+    {PERF_TYPE_SOFTWARE, PERF_COUNT_SW_PAGE_FAULTS},
+    {PERF_TYPE_SOFTWARE, PERF_COUNT_SW_CONTEXT_SWITCHES},
+};
+
+// Opens an event of the calling thread on any CPU. The leader starts disabled and members follow it.
+int open_event(const Event& event, int group_fd, bool exclude_kernel)
+{
+    perf_event_attr attr{};
+    attr.size = sizeof(attr);
+    attr.type = event.type;
+    attr.config = event.config;
+    attr.disabled = group_fd < 0;
+    attr.exclude_kernel = exclude_kernel;
+    attr.exclude_hv = 1;
+    attr.read_format = PERF_FORMAT_GROUP | PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+
+    return static_cast<int>(syscall(SYS_perf_event_open, &attr, 0, -1, group_fd, 0));
+}
+
+void add_event(PerfGroup& group, std::size_t event, int fd)
+{
+    if (group.leader < 0)
+        group.leader = fd;
+
+    group.events.push_back(event);
+    group.fds.push_back(fd);
+}
+
+void close_group(PerfGroup& group)
+{
+    for (const int fd : group.fds)
+        close(fd);
+}
+
+void start_group(const PerfGroup& group)
+{
+    if (group.leader < 0)
+        return;
+
+    ioctl(group.leader, PERF_EVENT_IOC_RESET, PERF_IOC_FLAG_GROUP);
+    ioctl(group.leader, PERF_EVENT_IOC_ENABLE, PERF_IOC_FLAG_GROUP);
+}
+
+void stop_group(const PerfGroup& group, std::vector<double>& counts)
+{
+    if (group.leader < 0)
+        return;
+
+    ioctl(group.leader, PERF_EVENT_IOC_DISABLE, PERF_IOC_FLAG_GROUP);
+
+    // Laid out as the number of events, time enabled, time running and then each count
+    std::uint64_t data[3 + PerfCounters::num_events]{};
+    const ssize_t size = read(group.leader, data, sizeof(data));
+
+    if (size < static_cast<ssize_t>(3 * sizeof(std::uint64_t)) || data[0] != group.events.size() || data[2] == 0)
+        return;
+
+    const double scale = double(data[1]) / data[2];
+
+    for (std::size_t i = 0; i < group.events.size(); ++i)
+        counts[group.events[i]] = data[3 + i] * scale;
+}
+
+} // namespace
+
+PerfCounters::PerfCounters()
+{
+    for (std::size_t i = 0; i < num_events; ++i)
+    {
+        PerfGroup& group = events[i].type == PERF_TYPE_SOFTWARE ? software : hardware;
+        int fd = open_event(events[i], group.leader, exclude_kernel);
+
+        // Counting in the kernel needs perf_event_paranoid < 2 or CAP_PERFMON
+        if (fd < 0 && (errno == EACCES || errno == EPERM) && !exclude_kernel)
+        {
+            exclude_kernel = true;
+            fd = open_event(events[i], group.leader, exclude_kernel);
+        }
+
+        if (fd >= 0)
+            add_event(group, i, fd);
+        else if (error == 0)
+            error = errno;
+    }
+}
+
+PerfCounters::~PerfCounters()
+{
+    close_group(hardware);
+    close_group(software);
+}
+
+bool PerfCounters::available(std::size_t i) const
+{
+    const PerfGroup& group = events[i].type == PERF_TYPE_SOFTWARE ? software : hardware;
+
+    for (const std::size_t event : group.events)
+    {
+        if (event == i)
+            return true;
+    }
+
+    return false;
+}
+
+void PerfCounters::start()
+{
+    start_group(hardware);
+    start_group(software);
+}
+
+std::vector<double> PerfCounters::stop()
+{
+    std::vector<double> result(num_events, -1.0);
+    stop_group(hardware, result);
+    stop_group(software, result);
+    return result;
+}
+
+const char* perf_error_message(int error)
+{
+    switch (error)
+    {
+    case ENOENT:
+    case ENODEV:
+    case EOPNOTSUPP:
+        return "not supported by this CPU or VM";
+    case EACCES:
+    case EPERM:
+        return "not permitted, see /proc/sys/kernel/perf_event_paranoid";
+    default:
+        return std::strerror(error);
+    }
+}
+
+PerfCounters* get_perf_counters() { return state.counters; }
+void set_perf_counters(PerfCounters* counters) { state.counters = counters; }
+
+} // namespace dr
@@ -0,0 +1,74 @@
+#pragma once
+
+#include <cstddef>
+#include <vector>
+
+namespace dr
+{
+
+// Events opened together whose counts are read in one go. Members are counted over the same
+// interval as their leader, so ratios between them (e.g. instructions per cycle) are meaningful.
+struct PerfGroup
+{
+    int leader{-1};
+
+    // Indices into PerfCounters::names of the events in the group, in the order they were opened
+    std::vector<std::size_t> events{};
+    std::vector<int> fds{};
+};
+
+// Counts hardware and software events of the calling thread with perf_event_open. Hardware and
+// software events are separate groups so a PMU that can't schedule the hardware group doesn't stop
+// the software counts. Events that can't be opened (e.g. no PMU in a VM, or perf_event_paranoid
+// too high) are skipped, and counting falls back to user space only if kernel counting isn't
+// permitted.
+struct PerfCounters
+{
+    static constexpr std::size_t num_events = 7;
+
+    static constexpr const char* names[num_events] = {
+        "cycles",
+        "instructions",
+        "l1d_misses",
+        "llc_misses",
+        "dtlb_misses",
+        "page_faults",
+        "context_switches",
+    };
+
+    PerfGroup hardware{};
+    PerfGroup software{};
+    bool exclude_kernel{};
+
+    // errno of the first event that couldn't be opened
+    int error{};
+
+    PerfCounters();
+
+    PerfCounters(const PerfCounters&) = delete;
+    PerfCounters& operator=(const PerfCounters&) = delete;
+
+    ~PerfCounters();
+
+    // Returns false if no event could be opened
+    bool valid() const { return hardware.leader >= 0 || software.leader >= 0; }
+
+    // Returns true if the event at index i was opened
+    bool available(std::size_t i) const;
+
+    // Resets the counts and starts counting
+    void start();
+
+    // Stops counting and returns the count of each event since start, scaled up if the group was
+    // multiplexed with other users of the PMU. Events that weren't counted are -1.
+    std::vector<double> stop();
+};
+
+// Describes the errno of perf_event_open, e.g. why an event is unavailable
+const char* perf_error_message(int error);
+
+// Counters used by run_benchmark, or null if not counting
+PerfCounters* get_perf_counters();
+void set_perf_counters(PerfCounters* counters);
+
+} // namespace dr
@@ -0,0 +1,507 @@
+#include <algorithm>
+#include <charconv>
+#include <cmath>
+#include <cstdlib>
+#include <random>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+#include <fmt/core.h>
+
+#include "benchmark.hpp"
+#include "json_value.hpp"
+
+namespace
+{
+
+// Exit status when a test regressed, as opposed to when the comparison couldn't be made
+constexpr int exit_regression = 1;
+constexpr int exit_error = 2;
+
+struct Settings
+{
+    // Changes whose confidence interval reaches within this fraction of no change aren't reported
+    // as regressions or improvements
+    double threshold{0.05};
+
+    // Significance level of the Mann-Whitney U test, also giving the confidence of the intervals
+    double alpha{0.05};
+
+    int resamples{10000};
+};
+
+struct Benchmark
+{
+    std::string name;
+    std::vector<double> samples;
+};
+
+// A results file, written by one process
+struct Results
+{
+    const char* path{};
+    dr::JsonValue document{};
+    std::vector<Benchmark> benchmarks{};
+};
+
+// Reads the benchmarks of a results file written with --json, naming each "stack / test [size n]".
+// Returns false if the file can't be read or isn't a results file.
+bool read_results(const char* path, dr::JsonValue& document, std::vector<Benchmark>& result)
+{
+    if (!dr::read_json(path, document))
+        return false;
+
+    const dr::JsonValue* const benchmarks = document.find("benchmarks");
+
+    if (benchmarks == nullptr || benchmarks->type != dr::JsonValue::Type::array)
+        return false;
+
+    for (const dr::JsonValue& benchmark : benchmarks->items)
+    {
+        const dr::JsonValue* const stack = benchmark.find("stack");
+        const dr::JsonValue* const test = benchmark.find("test");
+        const dr::JsonValue* const size = benchmark.find("size");
+        const dr::JsonValue* const samples = benchmark.find("samples_ns");
+
+        if (stack == nullptr || test == nullptr || samples == nullptr || samples->type != dr::JsonValue::Type::array)
+            return false;
+
+        Benchmark& b = result.emplace_back();
+        b.name = fmt::format("{} / {}", stack->string, test->string);
+
+        // Results written before sizes were recorded have none
+        if (size != nullptr && size->number > 0)
+            b.name += fmt::format(" [size {:.0f}]", size->number);
+
+        for (const dr::JsonValue& sample : samples->items)
+            b.samples.push_back(sample.number);
+    }
+
+    return true;
+}
+
+// Returns a field of the context of a results file, or an empty string if it has none
+std::string context_field(const dr::JsonValue& document, std::string_view key)
+{
+    const dr::JsonValue* const context = document.find("context");
+    const dr::JsonValue* const value = context != nullptr ? context->find(key) : nullptr;
+    return value != nullptr ? value->string : std::string{};
+}
+
+// Reorders values
+double median(std::vector<double>& values)
+{
+    const std::size_t mid = values.size() / 2;
+    std::nth_element(values.begin(), values.begin() + mid, values.end());
+
+    if (values.size() % 2 != 0)
+        return values[mid];
+
+    return (*std::max_element(values.begin(), values.begin() + mid) + values[mid]) / 2;
+}
+
+// Median run time of a test in each results file that has it, in file order. Runs of one process
+// share noise such as where its memory was placed, so only the medians of whole processes are
+// independent samples.
+std::vector<double> process_medians(const std::vector<Results>& side, const std::string& name)
+{
+    std::vector<double> medians{};
+
+    for (const Results& results : side)
+    {
+        for (const Benchmark& benchmark : results.benchmarks)
+        {
+            if (benchmark.name == name && !benchmark.samples.empty())
+                medians.push_back(dr::summarize(benchmark.samples).median);
+        }
+    }
+
+    return medians;
+}
+
+// Percentile bootstrap interval of the ratio of medians (after / before), at confidence 1 - alpha
+std::pair<double, double> bootstrap_ratio(
+    const std::vector<double>& before,
+    const std::vector<double>& after,
+    const Settings& settings,
+    std::mt19937_64& rng)
+{
+    std::uniform_int_distribution<std::size_t> pick_before{0, before.size() - 1};
+    std::uniform_int_distribution<std::size_t> pick_after{0, after.size() - 1};
+    std::vector<double> a(before.size());
+    std::vector<double> b(after.size());
+    std::vector<double> ratios(settings.resamples);
+
+    for (double& ratio : ratios)
+    {
+        for (double& value : a)
+            value = before[pick_before(rng)];
+
+        for (double& value : b)
+            value = after[pick_after(rng)];
+
+        ratio = median(b) / median(a);
+    }
+
+    std::sort(ratios.begin(), ratios.end());
+
+    const double last = ratios.size() - 1;
+    const auto lower = static_cast<std::size_t>(std::floor(settings.alpha / 2 * last));
+    const auto upper = static_cast<std::size_t>(std::ceil((1 - settings.alpha / 2) * last));
+    return {ratios[lower], ratios[upper]};
+}
+
+// Number of ways to pick k of n items
+double choose(std::size_t n, std::size_t k)
+{
+    double result = 1;
+
+    for (std::size_t i = 1; i <= k; ++i)
+        result = result * (n - k + i) / i;
+
+    return result;
+}
+
+// Two-sided p-value of U for samples of sizes n1 and n2 without ties, from the number of orderings
+// of the samples giving each value of U
+double exact_mann_whitney_p(double u, std::size_t n1, std::size_t n2)
+{
+    // Orderings of i values of a and j values of b with each U, over i. The largest value either
+    // comes from a, beating all j values of b, or from b, adding nothing.
+    std::vector<std::vector<double>> prev(n2 + 1, std::vector<double>(n1 * n2 + 1));
+    std::vector<std::vector<double>> curr = prev;
+
+    for (std::size_t j = 0; j <= n2; ++j)
+        prev[j][0] = 1;
+
+    for (std::size_t i = 1; i <= n1; ++i)
+    {
+        for (std::size_t j = 0; j <= n2; ++j)
+        {
+            for (std::size_t k = 0; k <= n1 * n2; ++k)
+                curr[j][k] = (k >= j ? prev[j][k - j] : 0) + (j > 0 ? curr[j - 1][k] : 0);
+        }
+
+        std::swap(prev, curr);
+    }
+
+    double below{};
+    double above{};
+
+    for (std::size_t k = 0; k <= n1 * n2; ++k)
+    {
+        if (k <= u) below += prev[n2][k];
+        if (k >= u) above += prev[n2][k];
+    }
+
+    return std::min(1.0, 2 * std::min(below, above) / choose(n1 + n2, n1));
+}
+
+// Two-sided p-value of the Mann-Whitney U test that neither sample tends to be larger. Small
+// samples without ties, such as the medians of a few processes, use the exact distribution of U.
+// Others use the normal approximation with tie and continuity corrections, which is good from
+// about 10 samples each.
+double mann_whitney_p(const std::vector<double>& a, const std::vector<double>& b)
+{
+    const double n1 = a.size();
+    const double n2 = b.size();
+    const double n = n1 + n2;
+
+    // Values paired with whether they're from a
+    std::vector<std::pair<double, bool>> values{};
+
+    for (const double value : a)
+        values.emplace_back(value, true);
+
+    for (const double value : b)
+        values.emplace_back(value, false);
+
+    std::sort(values.begin(), values.end());
+
+    double rank_sum{};
+    double tie_sum{};
+
+    for (std::size_t i = 0; i < values.size();)
+    {
+        std::size_t j = i;
+
+        while (j < values.size() && values[j].first == values[i].first)
+            ++j;
+
+        // Tied values share the average of ranks i + 1 to j
+        const double rank = (i + j + 1) / 2.0;
+        const double ties = j - i;
+
+        for (std::size_t k = i; k < j; ++k)
+        {
+            if (values[k].second)
+                rank_sum += rank;
+        }
+
+        tie_sum += ties * ties * ties - ties;
+        i = j;
+    }
+
+    const double u = rank_sum - n1 * (n1 + 1) / 2;
+
+    if (tie_sum == 0 && std::min(a.size(), b.size()) < 10 && std::max(a.size(), b.size()) <= 50)
+        return exact_mann_whitney_p(u, a.size(), b.size());
+
+    const double variance = n1 * n2 / 12 * ((n + 1) - tie_sum / (n * (n - 1)));
+
+    if (variance <= 0)
+        return 1.0;
+
+    const double z = std::max(0.0, std::abs(u - n1 * n2 / 2) - 0.5) / std::sqrt(variance);
+    return std::erfc(z / std::sqrt(2.0));
+}
+
+// Returns the smallest number of processes per side with which the Mann-Whitney test can be
+// significant at alpha, i.e. where the most extreme ordering of the medians is rare enough
+std::size_t min_processes(double alpha)
+{
+    std::size_t n = 1;
+
+    while (2 / choose(2 * n, n) >= alpha)
+        ++n;
+
+    return n;
+}
+
+[[noreturn]] void usage(const char* program, int status)
+{
+    fmt::print(
+        stderr,
+        "usage: {} <baseline.json>... -- <new.json>... [options]\n"
+        "       {} <baseline.json> <new.json> [options]\n"
+        "\n"
+        "Compares results written by pmr-test or pmr-eigen-test with --json, matching tests by\n"
+        "stack, name and size. Each file should come from a separate process. The median of each\n"
+        "process is one sample, since runs within a process share noise such as where its memory\n"
+        "was placed. A test regressed if its process medians are significantly slower and the\n"
+        "confidence interval of its change lies entirely above the threshold, so at least {}\n"
+        "files per side are needed at the default significance level. Exits with status 1 if any\n"
+        "test regressed, or 2 if the results can't be compared.\n"
+        "\n"
+        "options:\n"
+        "  --threshold <percent>  smallest change of the median to report (default 5)\n"
+        "  --alpha <p>            significance level, giving (1 - p) confidence intervals (default 0.05)\n"
+        "  --resamples <n>        bootstrap resamples (default 10000)\n"
+        "  --help                 show this message\n",
+        program,
+        program,
+        min_processes(Settings{}.alpha));
+
+    std::exit(status);
+}
+
+// Parses a number in (0, max], exiting if it's invalid
+template <typename T>
+T parse_number(const char* program, std::string_view value, T max)
+{
+    T result{};
+    const auto [end, error] = std::from_chars(value.data(), value.data() + value.size(), result);
+
+    if (error != std::errc{} || end != value.data() + value.size() || result <= 0 || result > max)
+        usage(program, exit_error);
+
+    return result;
+}
+
+} // namespace
+
+int main(int argc, char* argv[])
+{
+    // Baseline and new results files, split by "--" or given one each
+    std::vector<Results> sides[2]{};
+    bool separated{};
+    Settings settings{};
+
+    for (int i = 1; i < argc; ++i)
+    {
+        const std::string_view arg{argv[i]};
+
+        if (arg == "--help")
+        {
+            usage(argv[0], EXIT_SUCCESS);
+        }
+        else if (arg == "--threshold" || arg == "--alpha" || arg == "--resamples")
+        {
+            if (i + 1 >= argc)
+                usage(argv[0], exit_error);
+
+            const std::string_view value{argv[++i]};
+
+            if (arg == "--threshold")
+                settings.threshold = parse_number(argv[0], value, 1000.0) / 100;
+            else if (arg == "--alpha")
+                settings.alpha = parse_number(argv[0], value, 0.5);
+            else
+                settings.resamples = parse_number(argv[0], value, 10000000);
+        }
+        else if (arg == "--")
+        {
+            if (separated)
+                usage(argv[0], exit_error);
+
+            separated = true;
+        }
+        else
+        {
+            sides[separated ? 1 : 0].push_back({argv[i]});
+        }
+    }
+
+    // Without "--", two files are a baseline and a new result
+    if (!separated && sides[0].size() == 2)
+    {
+        sides[1].push_back(std::move(sides[0].back()));
+        sides[0].pop_back();
+    }
+
+    if (sides[0].empty() || sides[1].empty())
+        usage(argv[0], exit_error);
+
+    for (int i = 0; i < 2; ++i)
+    {
+        for (Results& results : sides[i])
+        {
+            if (!read_results(results.path, results.document, results.benchmarks))
+            {
+                fmt::print(stderr, "failed to read results from {}\n", results.path);
+                return exit_error;
+            }
+
+            fmt::print(
+                "{}: {} ({}, commit {})\n",
+                i == 0 ? "baseline" : "new",
+                results.path,
+                context_field(results.document, "date"),
+                context_field(results.document, "commit"));
+        }
+    }
+
+    // Timings from different machines or builds aren't comparable
+    const dr::JsonValue& reference = sides[0].front().document;
+
+    for (const std::vector<Results>& side : sides)
+    {
+        for (const Results& results : side)
+        {
+            for (const char* key : {"program", "cpu", "compiler", "build_type", "flags"})
+            {
+                const std::string before = context_field(reference, key);
+                const std::string after = context_field(results.document, key);
+
+                if (before != after)
+                {
+                    fmt::print(
+                        stderr,
+                        "warning: {} of {} differs: \"{}\" vs \"{}\"\n",
+                        key,
+                        results.path,
+                        before,
+                        after);
+                }
+            }
+        }
+    }
+
+    const std::size_t needed = min_processes(settings.alpha);
+
+    if (sides[0].size() < needed || sides[1].size() < needed)
+    {
+        fmt::print(
+            stderr,
+            "warning: changes can't be significant with fewer than {} results files per side\n",
+            needed);
+    }
+
+    fmt::print("\n");
+
+    // Tests in the order they first appear, baseline first
+    std::vector<std::string> names{};
+
+    for (const std::vector<Results>& side : sides)
+    {
+        for (const Results& results : side)
+        {
+            for (const Benchmark& benchmark : results.benchmarks)
+            {
+                if (std::find(names.begin(), names.end(), benchmark.name) == names.end())
+                    names.push_back(benchmark.name);
+            }
+        }
+    }
+
+    // Fixed seed so comparing the same files gives the same intervals
+    std::mt19937_64 rng{1};
+    const double confidence = 100 * (1 - settings.alpha);
+    int num_compared{};
+    int num_regressions{};
+    int num_improvements{};
+
+    for (const std::string& name : names)
+    {
+        std::vector<double> before = process_medians(sides[0], name);
+        std::vector<double> after = process_medians(sides[1], name);
+
+        if (before.empty() || after.empty())
+        {
+            fmt::print("{}: only in {}\n", name, before.empty() ? "new" : "baseline");
+            continue;
+        }
+
+        const auto [lower, upper] = bootstrap_ratio(before, after, settings, rng);
+        const double p = mann_whitney_p(before, after);
+        const std::size_t num_before = before.size();
+        const std::size_t num_after = after.size();
+        const double median_before = median(before);
+        const double median_after = median(after);
+        const double ratio = median_after / median_before;
+
+        const char* verdict = "";
+
+        // The process medians have to differ significantly and the whole interval has to lie
+        // beyond the threshold, so a change is only reported if it holds across processes and is
+        // likely to be larger than the threshold rather than just its point estimate
+        if (p < settings.alpha && lower > 1 + settings.threshold)
+        {
+            verdict = "  REGRESSION";
+            ++num_regressions;
+        }
+        else if (p < settings.alpha && upper < 1 - settings.threshold)
+        {
+            verdict = "  improvement";
+            ++num_improvements;
+        }
+
+        fmt::print(
+            "{}: {} -> {}, {:+.1f}% ({:.0f}% CI {:+.1f}% to {:+.1f}%), p {:.3f}, {} vs {} processes{}\n",
+            name,
+            dr::format_duration(median_before),
+            dr::format_duration(median_after),
+            100 * (ratio - 1),
+            confidence,
+            100 * (lower - 1),
+            100 * (upper - 1),
+            p,
+            num_before,
+            num_after,
+            verdict);
+
+        ++num_compared;
+    }
+
+    fmt::print(
+        "\n{} compared: {} regressions, {} improvements ({:.0f}% CI beyond {:.1f}%)\n",
+        num_compared,
+        num_regressions,
+        num_improvements,
+        confidence,
+        100 * settings.threshold);
+
+    return num_regressions > 0 ? exit_regression : 0;
+}
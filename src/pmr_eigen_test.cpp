@@ -1,5 +1,13 @@
-#include <chrono>
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <functional>
+#include <memory>
 #include <random>
+#include <string>
+#include <vector>
+
+#include <sys/resource.h>
 
 #include "eigen_memory_resource.hpp" // Must be included before Eigen headers
 #include <Eigen/Dense>
@@ -7,44 +15,31 @@
 
 #include <fmt/core.h>
 
+#include "arena_memory_resource.hpp"
+#include "benchmark.hpp"
+#include "buddy_memory_resource.hpp"
+#include "checked_memory_resource.hpp"
+#include "debug_memory_resource.hpp"
+#include "frame_memory_resource.hpp"
+#include "heap_profiler.hpp"
+#include "instrumentation.hpp"
+#include "huge_page_memory_resource.hpp"
+#include "latency_memory_resource.hpp"
+#include "lifetime_profiler.hpp"
+#include "options.hpp"
+#include "perf_counters.hpp"
+#include "recording_memory_resource.hpp"
+#include "results.hpp"
+#include "stack_sampler.hpp"
+#include "stats_segment.hpp"
+#include "tracing_memory_resource.hpp"
+
 namespace pmr = std::pmr;
 
 namespace
 {
 
-struct DebugMemoryResource : public pmr::memory_resource
-{
-    pmr::memory_resource* upstream;
-    int num_allocs{};
-    int num_deallocs{};
-    int curr_bytes{};
-    int max_bytes{};
-
-    DebugMemoryResource(pmr::memory_resource* upstream) :
-        upstream{upstream} {}
-
-    void* do_allocate(std::size_t bytes, std::size_t alignment) override
-    {
-        ++num_allocs;
-        curr_bytes += bytes;
-        if (curr_bytes > max_bytes) max_bytes = curr_bytes;
-        return upstream->allocate(bytes, alignment);
-    }
-
-    void do_deallocate(void* ptr, std::size_t bytes, std::size_t alignment) override
-    {
-        ++num_deallocs;
-        curr_bytes -= bytes;
-        upstream->deallocate(ptr, bytes, alignment);
-    }
-
-    bool do_is_equal(const pmr::memory_resource& other) const noexcept override
-    {
-        return this == &other;
-    };
-};
-
-void report(DebugMemoryResource* memory)
+void report(dr::DebugMemoryResource* memory)
 {
     if (memory != nullptr)
     {
@@ -52,6 +47,7 @@ void report(DebugMemoryResource* memory)
         fmt::print("num deallocs: {}\n", memory->num_deallocs);
         fmt::print("curr bytes: {}\n", memory->curr_bytes);
         fmt::print("max bytes: {}\n", memory->max_bytes);
+        dr::print_histograms(*memory);
     }
     else
     {
@@ -64,40 +60,61 @@ void report(DebugMemoryResource* memory)
     fmt::print("\n");
 }
 
-void dense_assign_test()
+// Matrix dimension of each test unless a sweep sets another size
+constexpr int default_size = 10;
+
+// Sizes run by --sweep, from a few cache lines per matrix to well past the last level cache
+const std::vector<int> sweep_sizes{4, 8, 16, 32, 64, 128, 256, 512, 1024, 2048};
+
+// Scales the iterations of a test so each run touches about as many matrix elements at every size
+// (10000 iterations at the default size)
+int iterations(int n)
+{
+    return std::max(1, 1000000 / (n * n));
+}
+
+// Multiplications do O(n^3) work, so their iterations are scaled by n^3 instead to keep the work
+// per run about the same (also 10000 iterations at the default size)
+int mult_iterations(int n)
+{
+    const long long work = static_cast<long long>(n) * n * n;
+    return static_cast<int>(std::max(1LL, 10000000 / work));
+}
+
+void dense_assign_test(dr::ArenaMemoryResource* scratch, int n)
 {
-    constexpr int n = 10;
     Eigen::MatrixXd A{n, n};
 
-    constexpr int iters = 10000;
+    const int iters = iterations(n);
     for (int i = 0; i < iters; ++i)
     {
+        dr::ArenaScope scope{scratch};
         Eigen::MatrixXd B{n, n};
         A = B;
     }
 }
 
-void dense_sum_test()
+void dense_sum_test(dr::ArenaMemoryResource* scratch, int n)
 {
-    constexpr int n = 10;
     Eigen::MatrixXd A{n, n};
 
-    constexpr int iters = 10000;
+    const int iters = iterations(n);
     for (int i = 0; i < iters; ++i)
     {
+        dr::ArenaScope scope{scratch};
         Eigen::MatrixXd B{n, n};
         A += B;
     }
 }
 
-void dense_mult_test()
+void dense_mult_test(dr::ArenaMemoryResource* scratch, int n)
 {
-    constexpr int n = 10;
     Eigen::MatrixXd A{n, n};
 
-    constexpr int iters = 10000;
+    const int iters = mult_iterations(n);
     for (int i = 0; i < iters; ++i)
     {
+        dr::ArenaScope scope{scratch};
         Eigen::MatrixXd B{n, n};
         A *= B;
     }
@@ -130,63 +147,83 @@ struct Random
     double operator()() { return dist(eng); }
 };
 
-void sparse_assign_test()
+// Assigns src to dst. With a scratch arena, dst's storage must outlive the current scope, so the
+// result is copied into the storage reserved by dst rather than swapped in.
+template <typename Src>
+void assign(Eigen::SparseMatrix<double>& dst, const Src& src, dr::ArenaMemoryResource* scratch)
+{
+    if (scratch != nullptr)
+    {
+        const Eigen::SparseMatrix<double> tmp = src;
+        dst = tmp;
+    }
+    else
+    {
+        dst = src;
+    }
+}
+
+void sparse_assign_test(dr::ArenaMemoryResource* scratch, int n)
 {
-    constexpr int n = 10;
     Random rnd{};
     Eigen::SparseMatrix<double> A = make_random_sparse(rnd, 0.8, n, n);
+    if (scratch != nullptr) A.reserve(n * n);
 
-    constexpr int iters = 10000;
+    const int iters = iterations(n);
     for (int i = 0; i < iters; ++i)
     {
+        dr::ArenaScope scope{scratch};
         Eigen::SparseMatrix<double> B = make_random_sparse(rnd, 0.8, n, n);
         A = B;
     }
 }
 
-void sparse_sum_test()
+void sparse_sum_test(dr::ArenaMemoryResource* scratch, int n)
 {
-    constexpr int n = 10;
     Random rnd{};
     Eigen::SparseMatrix<double> A = make_random_sparse(rnd, 0.8, n, n);
+    if (scratch != nullptr) A.reserve(n * n);
 
-    constexpr int iters = 10000;
+    const int iters = iterations(n);
     for (int i = 0; i < iters; ++i)
     {
+        dr::ArenaScope scope{scratch};
         Eigen::SparseMatrix<double> B = make_random_sparse(rnd, 0.8, n, n);
-        A += B;
+        assign(A, A + B, scratch); // A += B
     }
 }
 
-void sparse_mult_test()
+void sparse_mult_test(dr::ArenaMemoryResource* scratch, int n)
 {
-    constexpr int n = 10;
     Random rnd{};
     Eigen::SparseMatrix<double> A = make_random_sparse(rnd, 0.8, n, n);
+    if (scratch != nullptr) A.reserve(n * n);
 
-    constexpr int iters = 10000;
+    const int iters = mult_iterations(n);
     for (int i = 0; i < iters; ++i)
     {
+        dr::ArenaScope scope{scratch};
         Eigen::SparseMatrix<double> B = make_random_sparse(rnd, 0.8, n, n);
         // A *= B; // Gives linker error
-        A = A * B;
+        assign(A, A * B, scratch);
     }
 }
 
-void do_tests()
+// If a scratch arena is given, each test iteration runs in its own arena scope. If release is given,
+// it's called before each run to free what resources that grow left behind.
+void do_tests(dr::ArenaMemoryResource* scratch = nullptr, const std::function<void()>& release = nullptr)
 {
-    auto do_test = [=](void (*test)(), const char* context) {
-        using Clock = std::chrono::high_resolution_clock;
-        using Duration = std::chrono::milliseconds;
-
-        const auto start = Clock::now();
-        constexpr int n = 10;
+    auto do_test = [&](void (*test)(dr::ArenaMemoryResource*, int), const char* context) {
+        if (!dr::test_selected(context))
+            return;
 
-        for (int i = 0; i < n; ++i)
-            test();
+        const dr::TraceScope trace_scope{context};
 
-        const auto elapsed = std::chrono::duration_cast<Duration>(Clock::now() - start);
-        fmt::print("{} ({} ms)\n", context, static_cast<long long>(elapsed.count()));
+        const int size = dr::test_size(default_size);
+        const dr::BenchmarkResult result = dr::run_benchmark([&] { test(scratch, size); }, release);
+        fmt::print("{} ({})\n", context, dr::format_summary(result));
+        dr::print_counters(result);
+        dr::add_result(context, size, result);
     };
 
     do_test(dense_assign_test, "dense assign test");
@@ -198,26 +235,154 @@ void do_tests()
     do_test(sparse_mult_test, "sparse mult test");
 }
 
+// Resets memory in a simulation-style loop, either per step (frame resource) or per period of
+// steps (monotonic buffer resource)
+struct FrameReset
+{
+    dr::FrameMemoryResource* frame{};
+    pmr::monotonic_buffer_resource* buffer{};
+
+    void step()
+    {
+        if (frame != nullptr) frame->next_frame();
+    }
+
+    void period()
+    {
+        if (buffer != nullptr) buffer->release();
+    }
+};
+
+// Each step's result is read during the next step and then thrown away. Every period steps, the
+// state is carried over in storage from outside the resource being reset.
+void dense_sum_frame_test(FrameReset reset, int n)
+{
+    std::vector<double> storage(n * n);
+    Eigen::Map<Eigen::MatrixXd> state{storage.data(), n, n};
+
+    const int iters = iterations(n);
+    const int period = std::min(100, iters);
+    for (int i = 0; i < iters; i += period)
+    {
+        {
+            Eigen::MatrixXd A = state;
+
+            for (int j = 0; j < period; ++j)
+            {
+                reset.step();
+                Eigen::MatrixXd B{n, n};
+                Eigen::MatrixXd next = A + B;
+                A.swap(next);
+            }
+
+            state = A;
+        }
+
+        reset.period();
+    }
+}
+
+void sparse_mult_frame_test(FrameReset reset, int n)
+{
+    Random rnd{};
+    std::vector<double> storage(n * n);
+    Eigen::Map<Eigen::MatrixXd> state{storage.data(), n, n};
+    state = make_random_sparse(rnd, 0.8, n, n).toDense();
+
+    const int iters = mult_iterations(n);
+    const int period = std::min(100, iters);
+    for (int i = 0; i < iters; i += period)
+    {
+        {
+            Eigen::SparseMatrix<double> A = state.sparseView();
+
+            for (int j = 0; j < period; ++j)
+            {
+                reset.step();
+                Eigen::SparseMatrix<double> B = make_random_sparse(rnd, 0.8, n, n);
+                Eigen::SparseMatrix<double> next = A * B;
+                A.swap(next);
+            }
+
+            state = A.toDense();
+        }
+
+        reset.period();
+    }
+}
+
+void do_frame_tests(FrameReset reset)
+{
+    auto do_test = [=](void (*test)(FrameReset, int), const char* context) {
+        if (!dr::test_selected(context))
+            return;
+
+        const dr::TraceScope trace_scope{context};
+
+        const int size = dr::test_size(default_size);
+        const dr::BenchmarkResult result = dr::run_benchmark([&] { test(reset, size); });
+        fmt::print("{} ({})\n", context, dr::format_summary(result));
+        dr::print_counters(result);
+        dr::add_result(context, size, result);
+    };
+
+    do_test(dense_sum_frame_test, "dense sum frame test");
+    do_test(sparse_mult_frame_test, "sparse mult frame test");
+}
+
 void default_resource_test()
 {
-    fmt::print("default resource\n---\n");
-    DebugMemoryResource db_mem{pmr::new_delete_resource()};
+    if (!dr::begin_stack("default resource"))
+        return;
+
+    dr::DebugMemoryResource db_mem{pmr::new_delete_resource(), dr::Profiling::off};
+    dr::Instrumentation inst_mem{&db_mem};
 
-    dr::set_eigen_memory_resource(&db_mem);
+    dr::set_eigen_memory_resource(inst_mem.top);
     do_tests();
+    dr::print_latency(inst_mem.latency);
+
+    report(&db_mem);
+}
+
+// Large enough for the peak footprint of the tests
+constexpr std::size_t buddy_capacity = std::size_t{16} << 20;
+
+void buddy_resource_test()
+{
+    if (!dr::begin_stack("buddy resource"))
+        return;
+
+    dr::DebugMemoryResource db_mem{pmr::new_delete_resource(), dr::Profiling::off};
+
+    {
+        dr::BuddyMemoryResource buddy_mem{buddy_capacity, &db_mem};
+        dr::Instrumentation inst_mem{&buddy_mem};
+        dr::set_eigen_memory_resource(inst_mem.top);
+        do_tests();
+        dr::print_instrumentation(inst_mem, db_mem);
+
+        fmt::print("max block bytes: {}\n", buddy_mem.max_block_bytes);
+        fmt::print("internal fragmentation: {:.1f}%\n", 100.0 * buddy_mem.internal_fragmentation());
+        fmt::print("external fragmentation: {:.1f}%\n", 100.0 * buddy_mem.external_fragmentation());
+    }
 
     report(&db_mem);
 }
 
 void buffer_resource_test()
 {
-    fmt::print("buffer resource\n---\n");
-    DebugMemoryResource db_mem{pmr::new_delete_resource()};
+    if (!dr::begin_stack("buffer resource"))
+        return;
+
+    dr::DebugMemoryResource db_mem{pmr::new_delete_resource(), dr::Profiling::off};
 
     {
         pmr::monotonic_buffer_resource buf_mem{&db_mem};
-        dr::set_eigen_memory_resource(&buf_mem);
-        do_tests();
+        dr::Instrumentation inst_mem{&buf_mem};
+        dr::set_eigen_memory_resource(inst_mem.top);
+        do_tests(nullptr, [&] { buf_mem.release(); });
+        dr::print_instrumentation(inst_mem, db_mem);
     }
 
     report(&db_mem);
@@ -225,13 +390,71 @@ void buffer_resource_test()
 
 void pool_resource_test()
 {
-    fmt::print("pool resource\n---\n");
-    DebugMemoryResource db_mem{pmr::new_delete_resource()};
+    if (!dr::begin_stack("pool resource"))
+        return;
+
+    dr::DebugMemoryResource db_mem{pmr::new_delete_resource(), dr::Profiling::off};
 
     {
         pmr::unsynchronized_pool_resource pool_mem{&db_mem};
-        dr::set_eigen_memory_resource(&pool_mem);
+        dr::Instrumentation inst_mem{&pool_mem};
+        dr::set_eigen_memory_resource(inst_mem.top);
         do_tests();
+        dr::print_instrumentation(inst_mem, db_mem);
+    }
+
+    report(&db_mem);
+}
+
+void arena_resource_test()
+{
+    if (!dr::begin_stack("arena resource"))
+        return;
+
+    dr::DebugMemoryResource db_mem{pmr::new_delete_resource(), dr::Profiling::off};
+
+    {
+        dr::ArenaMemoryResource arena_mem{&db_mem};
+        dr::Instrumentation inst_mem{&arena_mem};
+        dr::set_eigen_memory_resource(inst_mem.top);
+        do_tests(&arena_mem, [&] { arena_mem.release(); });
+        dr::print_instrumentation(inst_mem, db_mem);
+    }
+
+    report(&db_mem);
+}
+
+void released_buffer_resource_frame_test()
+{
+    if (!dr::begin_stack("released buffer resource (frame tests)"))
+        return;
+
+    dr::DebugMemoryResource db_mem{pmr::new_delete_resource(), dr::Profiling::off};
+
+    {
+        pmr::monotonic_buffer_resource buf_mem{&db_mem};
+        dr::Instrumentation inst_mem{&buf_mem};
+        dr::set_eigen_memory_resource(inst_mem.top);
+        do_frame_tests({nullptr, &buf_mem});
+        dr::print_instrumentation(inst_mem, db_mem);
+    }
+
+    report(&db_mem);
+}
+
+void frame_resource_frame_test()
+{
+    if (!dr::begin_stack("frame resource (frame tests)"))
+        return;
+
+    dr::DebugMemoryResource db_mem{pmr::new_delete_resource(), dr::Profiling::off};
+
+    {
+        dr::FrameMemoryResource frame_mem{&db_mem};
+        dr::Instrumentation inst_mem{&frame_mem};
+        dr::set_eigen_memory_resource(inst_mem.top);
+        do_frame_tests({&frame_mem, nullptr});
+        dr::print_instrumentation(inst_mem, db_mem);
     }
 
     report(&db_mem);
@@ -239,14 +462,18 @@ void pool_resource_test()
 
 void pool_backed_buffer_resource_test()
 {
-    fmt::print("pool backed buffer resource\n---\n");
-    DebugMemoryResource db_mem{pmr::new_delete_resource()};
+    if (!dr::begin_stack("pool backed buffer resource"))
+        return;
+
+    dr::DebugMemoryResource db_mem{pmr::new_delete_resource(), dr::Profiling::off};
 
     {
         pmr::unsynchronized_pool_resource pool_mem{&db_mem};
         pmr::monotonic_buffer_resource buf_mem{&pool_mem};
-        dr::set_eigen_memory_resource(&buf_mem);
-        do_tests();
+        dr::Instrumentation inst_mem{&buf_mem};
+        dr::set_eigen_memory_resource(inst_mem.top);
+        do_tests(nullptr, [&] { buf_mem.release(); pool_mem.release(); });
+        dr::print_instrumentation(inst_mem, db_mem);
     }
 
     report(&db_mem);
@@ -254,27 +481,299 @@ void pool_backed_buffer_resource_test()
 
 void buffer_backed_pool_resource_test()
 {
-    fmt::print("buffer backed pool resource\n---\n");
-    DebugMemoryResource db_mem{pmr::new_delete_resource()};
+    if (!dr::begin_stack("buffer backed pool resource"))
+        return;
+
+    dr::DebugMemoryResource db_mem{pmr::new_delete_resource(), dr::Profiling::off};
 
     {
         pmr::monotonic_buffer_resource buf_mem{&db_mem};
         pmr::unsynchronized_pool_resource pool_mem{&buf_mem};
-        dr::set_eigen_memory_resource(&pool_mem);
-        do_tests();
+        dr::Instrumentation inst_mem{&pool_mem};
+        dr::set_eigen_memory_resource(inst_mem.top);
+        do_tests(nullptr, [&] { pool_mem.release(); buf_mem.release(); });
+        dr::print_instrumentation(inst_mem, db_mem);
     }
 
     report(&db_mem);
 }
 
-} // namespace
+long page_faults()
+{
+    rusage usage{};
+    getrusage(RUSAGE_SELF, &usage);
+    return usage.ru_minflt + usage.ru_majflt;
+}
+
+// Capacity of the huge page arenas. Larger requests fall back to new/delete.
+constexpr std::size_t huge_page_capacity = std::size_t{1024} << 20;
+
+void huge_page_buffer_resource_test(const char* context, bool huge_pages, bool prefault)
+{
+    if (!dr::begin_stack(context))
+        return;
+
+    const long start_faults = page_faults();
+
+    {
+        dr::HugePageMemoryResource huge_mem{huge_pages ? huge_page_capacity : 0, prefault};
+        dr::DebugMemoryResource db_mem{&huge_mem, dr::Profiling::off};
+
+        {
+            pmr::monotonic_buffer_resource buf_mem{&db_mem};
+            dr::Instrumentation inst_mem{&buf_mem};
+            dr::set_eigen_memory_resource(inst_mem.top);
+            do_tests(nullptr, [&] { buf_mem.release(); });
+            dr::print_instrumentation(inst_mem, db_mem);
+        }
+
+        fmt::print("page faults: {}\n", page_faults() - start_faults);
+        report(&db_mem);
+    }
+}
+
+void huge_page_pool_backed_buffer_resource_test(const char* context, bool huge_pages, bool prefault)
+{
+    if (!dr::begin_stack(context))
+        return;
+
+    const long start_faults = page_faults();
+
+    {
+        dr::HugePageMemoryResource huge_mem{huge_pages ? huge_page_capacity : 0, prefault};
+        dr::DebugMemoryResource db_mem{&huge_mem, dr::Profiling::off};
+
+        {
+            pmr::unsynchronized_pool_resource pool_mem{&db_mem};
+            pmr::monotonic_buffer_resource buf_mem{&pool_mem};
+            dr::Instrumentation inst_mem{&buf_mem};
+            dr::set_eigen_memory_resource(inst_mem.top);
+            do_tests(nullptr, [&] { buf_mem.release(); pool_mem.release(); });
+            dr::print_instrumentation(inst_mem, db_mem);
+        }
+
+        fmt::print("page faults: {}\n", page_faults() - start_faults);
+        report(&db_mem);
+    }
+}
+
+void huge_page_tests()
+{
+    huge_page_buffer_resource_test("buffer resource", false, false);
+    huge_page_buffer_resource_test("huge page buffer resource", true, false);
+    huge_page_buffer_resource_test("prefaulted huge page buffer resource", true, true);
+
+    huge_page_pool_backed_buffer_resource_test("pool backed buffer resource", false, false);
+    huge_page_pool_backed_buffer_resource_test("huge page pool backed buffer resource", true, false);
+    huge_page_pool_backed_buffer_resource_test("prefaulted huge page pool backed buffer resource", true, true);
+}
+
+// Profiles block lifetimes of each test on its own and recommends a resource for it
+void lifetime_tests()
+{
+    auto do_test = [](void (*test)(dr::ArenaMemoryResource*, int), const char* context) {
+        if (!dr::test_selected(context))
+            return;
+
+        fmt::print("{}\n---\n", context);
+        dr::DebugMemoryResource db_mem{pmr::new_delete_resource()};
+        db_mem.lifetimes = std::make_unique<dr::LifetimeProfiler>();
+
+        dr::set_eigen_memory_resource(&db_mem);
+        test(nullptr, default_size);
+
+        dr::print_lifetimes(db_mem);
+        fmt::print("\n");
+    };
+
+    do_test(dense_assign_test, "dense assign test");
+    do_test(dense_sum_test, "dense sum test");
+    do_test(dense_mult_test, "dense mult test");
+
+    do_test(sparse_assign_test, "sparse assign test");
+    do_test(sparse_sum_test, "sparse sum test");
+    do_test(sparse_mult_test, "sparse mult test");
+}
+
+// Runs each test once, recording its allocations for pmr-replay. Exits if the trace can't be
+// written.
+void record_tests(const char* path)
+{
+    std::FILE* const file = std::fopen(path, "wb");
+
+    if (file == nullptr)
+    {
+        fmt::print(stderr, "failed to write {}\n", path);
+        std::exit(EXIT_FAILURE);
+    }
+
+    dr::RecordingMemoryResource rec_mem{pmr::new_delete_resource(), file};
+    dr::set_eigen_memory_resource(&rec_mem);
+
+    auto do_test = [](void (*test)(dr::ArenaMemoryResource*, int), const char* context) {
+        if (dr::test_selected(context))
+            test(nullptr, default_size);
+    };
+
+    do_test(dense_assign_test, "dense assign test");
+    do_test(dense_sum_test, "dense sum test");
+    do_test(dense_mult_test, "dense mult test");
+
+    do_test(sparse_assign_test, "sparse assign test");
+    do_test(sparse_sum_test, "sparse sum test");
+    do_test(sparse_mult_test, "sparse mult test");
+
+    dr::set_eigen_memory_resource(pmr::get_default_resource());
+
+    // Flush before closing so the destructor has nothing left to write
+    const bool flushed = rec_mem.flush();
 
-int main()
+    if (std::fclose(file) != 0 || !flushed)
+    {
+        fmt::print(stderr, "failed to write {}\n", path);
+        std::exit(EXIT_FAILURE);
+    }
+}
+
+// Runs every test except those selected by options
+void all_tests()
 {
     default_resource_test();
     pool_resource_test();
+    buddy_resource_test();
     buffer_resource_test();
+    arena_resource_test();
     buffer_backed_pool_resource_test();
     pool_backed_buffer_resource_test();
+
+    released_buffer_resource_frame_test();
+    frame_resource_frame_test();
+}
+
+} // namespace
+
+int main(int argc, char* argv[])
+{
+    const dr::Options options = dr::parse_options(argc, argv);
+
+    dr::StackSampler sampler{
+        options.sample_bytes ? dr::StackSampler::Unit::bytes : dr::StackSampler::Unit::allocations,
+        options.sample_interval};
+
+    if (options.folded != nullptr)
+        dr::set_stack_sampler(&sampler);
+
+    dr::HeapProfiler heap_profiler{options.heap_sample_bytes};
+
+    if (options.heap_profile != nullptr)
+    {
+        dr::set_heap_profiler(&heap_profiler);
+        dr::dump_heap_profile_on_signal(options.heap_profile);
+    }
+
+    std::unique_ptr<dr::Tracer> tracer{};
+
+    if (options.trace != nullptr)
+    {
+        tracer = std::make_unique<dr::Tracer>();
+        dr::set_tracer(tracer.get());
+    }
+
+    std::unique_ptr<dr::StatsPublisher> publisher{};
+
+    if (options.stats)
+    {
+        publisher = std::make_unique<dr::StatsPublisher>();
+
+        if (!publisher->valid())
+        {
+            fmt::print(stderr, "failed to create stats segment\n");
+            return 1;
+        }
+
+        dr::set_stats_publisher(publisher.get());
+    }
+
+    dr::set_stack_filter(options.stacks);
+    dr::set_test_filter(options.tests);
+    std::unique_ptr<dr::PerfCounters> counters{};
+
+    if (options.perf)
+    {
+        counters = std::make_unique<dr::PerfCounters>();
+
+        if (!counters->valid())
+        {
+            fmt::print(stderr, "perf counters unavailable: {}\n", dr::perf_error_message(counters->error));
+            counters.reset();
+        }
+        else
+        {
+            std::string missing{};
+
+            for (std::size_t i = 0; i < dr::PerfCounters::num_events; ++i)
+            {
+                if (!counters->available(i))
+                    missing += fmt::format("{}{}", missing.empty() ? "" : ", ", dr::PerfCounters::names[i]);
+            }
+
+            if (!missing.empty())
+                fmt::print(stderr, "perf counters unavailable: {} ({})\n", missing, dr::perf_error_message(counters->error));
+
+            dr::set_perf_counters(counters.get());
+        }
+    }
+
+    dr::set_utilization_metrics(options.utilization);
+    dr::set_latency_timing(options.latency);
+    dr::set_check_sample_rate(options.check_sample_rate);
+
+    if (options.huge_pages)
+        huge_page_tests();
+    else if (options.lifetimes)
+        lifetime_tests();
+    else if (options.record != nullptr)
+        record_tests(options.record);
+    else if (options.sweep)
+        dr::sweep_tests(all_tests, options.sizes.empty() ? sweep_sizes : options.sizes);
+    else
+        all_tests();
+
+    if (options.folded != nullptr && !sampler.write_folded(options.folded))
+    {
+        fmt::print(stderr, "failed to write {}\n", options.folded);
+        return 1;
+    }
+
+    if (options.heap_profile != nullptr && !heap_profiler.write(options.heap_profile))
+    {
+        fmt::print(stderr, "failed to write {}\n", options.heap_profile);
+        return 1;
+    }
+
+    if (tracer != nullptr && !tracer->write_chrome_trace(options.trace))
+    {
+        fmt::print(stderr, "failed to write {}\n", options.trace);
+        return 1;
+    }
+
+    if (options.json != nullptr && !dr::write_json(options.json, argv[0]))
+    {
+        fmt::print(stderr, "failed to write {}\n", options.json);
+        return 1;
+    }
+
+    if (options.csv != nullptr && !dr::write_csv(options.csv, argv[0]))
+    {
+        fmt::print(stderr, "failed to write {}\n", options.csv);
+        return 1;
+    }
+
+    if (dr::check_violations() > 0)
+    {
+        fmt::print(stderr, "{} contract violations\n", dr::check_violations());
+        return 1;
+    }
+
     return 0;
 }
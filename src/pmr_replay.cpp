@@ -0,0 +1,367 @@
+#include <algorithm>
+#include <chrono>
+#include <charconv>
+#include <cstdlib>
+#include <memory_resource>
+#include <string_view>
+#include <vector>
+
+#include <fmt/core.h>
+
+#include "arena_memory_resource.hpp"
+#include "buddy_memory_resource.hpp"
+#include "debug_memory_resource.hpp"
+#include "latency_memory_resource.hpp"
+#include "recording_memory_resource.hpp"
+#include "slab_memory_resource.hpp"
+#include "tlsf_memory_resource.hpp"
+
+namespace pmr = std::pmr;
+
+namespace
+{
+
+struct Replay
+{
+    const dr::AllocationTrace* trace;
+    int runs;
+};
+
+// Peak bytes the trace has live, i.e. requested from each stack
+std::size_t peak_bytes(const dr::AllocationTrace& trace)
+{
+    std::size_t curr_bytes{};
+    std::size_t max_bytes{};
+
+    for (const dr::TraceOp& op : trace.ops)
+    {
+        if (op.allocate)
+        {
+            curr_bytes += op.bytes;
+            max_bytes = std::max(max_bytes, curr_bytes);
+        }
+        else
+        {
+            curr_bytes -= op.bytes;
+        }
+    }
+
+    return max_bytes;
+}
+
+// Replays the trace once per run against a stack built by with_stack, which creates the stack
+// and passes its top to the callable it's given. Each run gets a fresh stack, so every run starts
+// from empty resources rather than reusing memory a resource kept from the previous run. Only the
+// allocate and deallocate calls are timed, back to back without the work the program did between
+// them. Blocks the trace leaves live are freed after each run (untimed) before the stack is
+// destroyed. Calls go to the stack directly unless latency timing is on.
+//
+// If given, reserved wraps the upstream of the stack and its peak is reported against the peak
+// bytes of the trace.
+template <typename Stack>
+void do_replay(const Replay& replay, const dr::DebugMemoryResource* reserved, Stack&& with_stack)
+{
+    using Clock = std::chrono::high_resolution_clock;
+    using Duration = std::chrono::milliseconds;
+
+    const dr::AllocationTrace& trace = *replay.trace;
+    std::vector<void*> ptrs(trace.num_allocs);
+    Clock::duration elapsed{};
+
+    // Kept across runs so the percentiles cover all of them
+    dr::LatencyMemoryResource lat_mem{nullptr};
+
+    auto run = [&](pmr::memory_resource* top) {
+        lat_mem.upstream = top;
+        pmr::memory_resource* const memory = lat_mem.enabled ? &lat_mem : top;
+        const auto start = Clock::now();
+
+        for (const dr::TraceOp& op : trace.ops)
+        {
+            const std::size_t alignment = std::size_t{1} << op.alignment_log2;
+
+            if (op.allocate)
+            {
+                ptrs[op.id] = memory->allocate(op.bytes, alignment);
+            }
+            else
+            {
+                memory->deallocate(ptrs[op.id], op.bytes, alignment);
+                ptrs[op.id] = nullptr;
+            }
+        }
+
+        elapsed += Clock::now() - start;
+
+        for (const dr::TraceOp& op : trace.ops)
+        {
+            if (op.allocate && ptrs[op.id] != nullptr)
+            {
+                top->deallocate(ptrs[op.id], op.bytes, std::size_t{1} << op.alignment_log2);
+                ptrs[op.id] = nullptr;
+            }
+        }
+    };
+
+    for (int i = 0; i < replay.runs; ++i)
+        with_stack(run);
+
+    const auto ns = std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count();
+    const std::size_t num_ops = trace.ops.size() * replay.runs;
+
+    fmt::print(
+        "replay ({} ms, {:.1f} ns/op)\n",
+        static_cast<long long>(std::chrono::duration_cast<Duration>(elapsed).count()),
+        num_ops > 0 ? double(ns) / num_ops : 0.0);
+
+    if (reserved != nullptr)
+        dr::print_utilization(peak_bytes(trace), reserved->max_bytes);
+
+    dr::print_latency(lat_mem);
+}
+
+void report(dr::DebugMemoryResource* memory)
+{
+    fmt::print("num allocs: {}\n", memory->num_allocs);
+    fmt::print("num deallocs: {}\n", memory->num_deallocs);
+    fmt::print("max bytes: {}\n", memory->max_bytes);
+    fmt::print("\n");
+}
+
+// Large enough for the peak footprint of typical traces. Larger requests fall back to upstream.
+constexpr std::size_t region_capacity = std::size_t{64} << 20;
+
+void default_resource_replay(const Replay& replay)
+{
+    fmt::print("default resource\n---\n");
+
+    do_replay(replay, nullptr, [](auto run) {
+        run(pmr::new_delete_resource());
+    });
+
+    fmt::print("\n");
+}
+
+void pool_resource_replay(const Replay& replay)
+{
+    fmt::print("pool resource\n---\n");
+    dr::DebugMemoryResource db_mem{pmr::new_delete_resource()};
+
+    do_replay(replay, &db_mem, [&](auto run) {
+        pmr::unsynchronized_pool_resource pool_mem{&db_mem};
+        run(&pool_mem);
+    });
+
+    report(&db_mem);
+}
+
+void slab_resource_replay(const Replay& replay)
+{
+    fmt::print("slab resource\n---\n");
+    dr::DebugMemoryResource db_mem{pmr::new_delete_resource()};
+
+    do_replay(replay, &db_mem, [&](auto run) {
+        dr::SlabMemoryResource slab_mem{&db_mem};
+        run(&slab_mem);
+    });
+
+    report(&db_mem);
+}
+
+void tlsf_resource_replay(const Replay& replay)
+{
+    fmt::print("tlsf resource\n---\n");
+    dr::DebugMemoryResource db_mem{pmr::new_delete_resource()};
+
+    do_replay(replay, &db_mem, [&](auto run) {
+        dr::TlsfMemoryResource tlsf_mem{region_capacity, &db_mem};
+        run(&tlsf_mem);
+    });
+
+    report(&db_mem);
+}
+
+void buddy_resource_replay(const Replay& replay)
+{
+    fmt::print("buddy resource\n---\n");
+    dr::DebugMemoryResource db_mem{pmr::new_delete_resource()};
+
+    do_replay(replay, &db_mem, [&](auto run) {
+        dr::BuddyMemoryResource buddy_mem{region_capacity, &db_mem};
+        run(&buddy_mem);
+    });
+
+    report(&db_mem);
+}
+
+void buffer_resource_replay(const Replay& replay)
+{
+    fmt::print("buffer resource\n---\n");
+    dr::DebugMemoryResource db_mem{pmr::new_delete_resource()};
+
+    do_replay(replay, &db_mem, [&](auto run) {
+        pmr::monotonic_buffer_resource buf_mem{&db_mem};
+        run(&buf_mem);
+    });
+
+    report(&db_mem);
+}
+
+void arena_resource_replay(const Replay& replay)
+{
+    fmt::print("arena resource\n---\n");
+    dr::DebugMemoryResource db_mem{pmr::new_delete_resource()};
+
+    do_replay(replay, &db_mem, [&](auto run) {
+        dr::ArenaMemoryResource arena_mem{&db_mem};
+        run(&arena_mem);
+    });
+
+    report(&db_mem);
+}
+
+void pool_backed_buffer_resource_replay(const Replay& replay)
+{
+    fmt::print("pool backed buffer resource\n---\n");
+    dr::DebugMemoryResource db_mem{pmr::new_delete_resource()};
+
+    do_replay(replay, &db_mem, [&](auto run) {
+        pmr::unsynchronized_pool_resource pool_mem{&db_mem};
+        pmr::monotonic_buffer_resource buf_mem{&pool_mem};
+        run(&buf_mem);
+    });
+
+    report(&db_mem);
+}
+
+void buffer_backed_pool_resource_replay(const Replay& replay)
+{
+    fmt::print("buffer backed pool resource\n---\n");
+    dr::DebugMemoryResource db_mem{pmr::new_delete_resource()};
+
+    do_replay(replay, &db_mem, [&](auto run) {
+        pmr::monotonic_buffer_resource buf_mem{&db_mem};
+        pmr::unsynchronized_pool_resource pool_mem{&buf_mem};
+        run(&pool_mem);
+    });
+
+    report(&db_mem);
+}
+
+struct Chain
+{
+    std::string_view name;
+    void (*replay)(const Replay&);
+};
+
+constexpr Chain chains[] = {
+    {"default", default_resource_replay},
+    {"pool", pool_resource_replay},
+    {"slab", slab_resource_replay},
+    {"tlsf", tlsf_resource_replay},
+    {"buddy", buddy_resource_replay},
+    {"buffer", buffer_resource_replay},
+    {"arena", arena_resource_replay},
+    {"pool-backed-buffer", pool_backed_buffer_resource_replay},
+    {"buffer-backed-pool", buffer_backed_pool_resource_replay},
+};
+
+[[noreturn]] void usage(const char* program, int status)
+{
+    fmt::print(
+        stderr,
+        "usage: {} <trace> [options] [resource...]\n"
+        "\n"
+        "Replays a trace recorded with --record against each resource (all by default)\n"
+        "\n"
+        "resources:\n"
+        "  ",
+        program);
+
+    for (const Chain& chain : chains)
+        fmt::print(stderr, "{} ", chain.name);
+
+    fmt::print(
+        stderr,
+        "\n"
+        "\n"
+        "options:\n"
+        "  --runs <n>  number of times to replay the trace (default 10)\n"
+        "  --latency   report allocate/deallocate latency percentiles\n"
+        "  --help      show this message\n");
+
+    std::exit(status);
+}
+
+} // namespace
+
+int main(int argc, char* argv[])
+{
+    const char* path{};
+    int runs = 10;
+    std::vector<std::string_view> selected{};
+
+    for (int i = 1; i < argc; ++i)
+    {
+        const std::string_view arg{argv[i]};
+
+        if (arg == "--help")
+        {
+            usage(argv[0], EXIT_SUCCESS);
+        }
+        else if (arg == "--runs")
+        {
+            if (i + 1 >= argc)
+                usage(argv[0], EXIT_FAILURE);
+
+            const std::string_view value{argv[++i]};
+            const auto [end, error] = std::from_chars(value.data(), value.data() + value.size(), runs);
+
+            if (error != std::errc{} || end != value.data() + value.size() || runs <= 0)
+                usage(argv[0], EXIT_FAILURE);
+        }
+        else if (arg == "--latency")
+        {
+            dr::set_latency_timing(true);
+        }
+        else if (path == nullptr)
+        {
+            path = argv[i];
+        }
+        else
+        {
+            bool found = false;
+
+            for (const Chain& chain : chains)
+                found |= chain.name == arg;
+
+            if (!found)
+                usage(argv[0], EXIT_FAILURE);
+
+            selected.push_back(arg);
+        }
+    }
+
+    if (path == nullptr)
+        usage(argv[0], EXIT_FAILURE);
+
+    dr::AllocationTrace trace{};
+
+    if (!dr::read_trace(path, trace))
+    {
+        fmt::print(stderr, "failed to read trace {}\n", path);
+        return 1;
+    }
+
+    fmt::print("{}: {} allocs, {} ops, {} runs\n\n", path, trace.num_allocs, trace.ops.size(), runs);
+
+    const Replay replay{&trace, runs};
+
+    for (const Chain& chain : chains)
+    {
+        if (selected.empty() || std::find(selected.begin(), selected.end(), chain.name) != selected.end())
+            chain.replay(replay);
+    }
+
+    return 0;
+}
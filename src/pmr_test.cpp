@@ -1,53 +1,65 @@
+#include <algorithm>
 #include <chrono>
 #include <charconv>
+#include <condition_variable>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <deque>
+#include <functional>
+#include <memory>
 #include <memory_resource>
+#include <mutex>
+#include <random>
 #include <vector>
 #include <string>
+#include <thread>
 #include <unordered_map>
 
+#include <sys/resource.h>
+
 #include <fmt/core.h>
 
+#include "arena_memory_resource.hpp"
+#include "benchmark.hpp"
+#include "checked_memory_resource.hpp"
+#include "concurrent_debug_memory_resource.hpp"
+#include "debug_memory_resource.hpp"
+#include "expandable_vector.hpp"
+#include "heap_profiler.hpp"
+#include "instrumentation.hpp"
+#include "huge_page_memory_resource.hpp"
+#include "inline_memory_resource.hpp"
+#include "latency_memory_resource.hpp"
+#include "lifetime_profiler.hpp"
+#include "options.hpp"
+#include "perf_counters.hpp"
+#include "recording_memory_resource.hpp"
+#include "results.hpp"
+#include "slab_memory_resource.hpp"
+#include "stack_sampler.hpp"
+#include "stats_segment.hpp"
+#include "thread_caching_memory_resource.hpp"
+#include "tlsf_memory_resource.hpp"
+#include "tracing_memory_resource.hpp"
+
 namespace pmr = std::pmr;
 
 namespace
 {
 
-struct DebugMemoryResource : public pmr::memory_resource
-{
-    pmr::memory_resource* upstream;
-    std::size_t num_allocs{};
-    std::size_t num_deallocs{};
-    std::size_t curr_bytes{};
-    std::size_t max_bytes{};
-
-    DebugMemoryResource(pmr::memory_resource* upstream) :
-        upstream{upstream} {}
-
-    void* do_allocate(std::size_t bytes, std::size_t alignment) override
-    {
-        ++num_allocs;
-        curr_bytes += bytes;
-        if (curr_bytes > max_bytes) max_bytes = curr_bytes;
-        return upstream->allocate(bytes, alignment);
-    }
+// Number of elements each test inserts unless a sweep sets another size. Map entries cost several
+// times more than vector elements, so the map tests insert a tenth as many.
+constexpr int default_size = 100000;
 
-    void do_deallocate(void* ptr, std::size_t bytes, std::size_t alignment) override
-    {
-        ++num_deallocs;
-        curr_bytes -= bytes;
-        upstream->deallocate(ptr, bytes, alignment);
-    }
+// Sizes run by --sweep, from well within L1 to well past the last level cache
+const std::vector<int> sweep_sizes{100, 1000, 10000, 100000, 1000000, 10000000};
 
-    bool do_is_equal(const pmr::memory_resource& other) const noexcept override
-    {
-        return this == &other;
-    };
-};
+// Elements per inner container of the nested tests
+constexpr int inner_size = 100;
 
-void vector_test_1(pmr::memory_resource* memory)
+void vector_test_1(pmr::memory_resource* memory, int n)
 {
-    constexpr int n = 100000;
-
     if (memory != nullptr)
     {
         pmr::vector<int> vec{memory};
@@ -64,10 +76,10 @@ void vector_test_1(pmr::memory_resource* memory)
     }
 }
 
-void vector_test_2(pmr::memory_resource* memory)
+void vector_test_2(pmr::memory_resource* memory, int size)
 {
-    constexpr int n = 1000;
-    constexpr int m = 100;
+    const int n = std::max(1, size / inner_size);
+    constexpr int m = inner_size;
 
     if (memory != nullptr)
     {
@@ -99,9 +111,9 @@ void vector_test_2(pmr::memory_resource* memory)
     }
 }
 
-void unordered_map_test_1(pmr::memory_resource* memory)
+void unordered_map_test_1(pmr::memory_resource* memory, int size)
 {
-    constexpr int n = 10000;
+    const int n = std::max(1, size / 10);
     char buf[64]{};
 
     if (memory != nullptr)
@@ -126,10 +138,10 @@ void unordered_map_test_1(pmr::memory_resource* memory)
     }
 }
 
-void unordered_map_test_2(pmr::memory_resource* memory)
+void unordered_map_test_2(pmr::memory_resource* memory, int size)
 {
-    constexpr int n = 100;
-    constexpr int m = 100;
+    const int n = std::max(1, size / 10 / inner_size);
+    constexpr int m = inner_size;
     char buf[64]{};
 
     if (memory != nullptr)
@@ -170,20 +182,96 @@ void unordered_map_test_2(pmr::memory_resource* memory)
     }
 }
 
-void do_tests(pmr::memory_resource* memory)
+// Same as vector_test_2 but each inner vector is built in a stack buffer before being copied
+// into the outer vector
+void vector_test_2_inline(pmr::memory_resource* memory, int size)
 {
-    auto do_test = [=](void (*test)(pmr::memory_resource*), const char* context) {
-        using Clock = std::chrono::high_resolution_clock;
-        using Duration = std::chrono::milliseconds;
+    const int n = std::max(1, size / inner_size);
+    constexpr int m = inner_size;
 
-        const auto start = Clock::now();
-        constexpr int n = 10;
+    pmr::vector<pmr::vector<int>> vecs{memory};
 
-        for (int i = 0; i < n; ++i)
-            test(memory);
+    for (int i = 0; i < n; ++i)
+    {
+        dr::InlineMemoryResource<1024> local_mem{memory};
+        pmr::vector<int> vec{&local_mem};
+
+        for (int j = 0; j < m; ++j)
+            vec.push_back(j);
+
+        vecs.push_back(std::move(vec));
+    }
+}
+
+// Same as unordered_map_test_2 but each inner map is built in a stack buffer before being copied
+// into the outer map
+void unordered_map_test_2_inline(pmr::memory_resource* memory, int size)
+{
+    const int n = std::max(1, size / 10 / inner_size);
+    constexpr int m = inner_size;
+    char buf[64]{};
+
+    pmr::unordered_map<pmr::string, pmr::unordered_map<pmr::string, int>> maps{memory};
+
+    for (int i = 0; i < n; ++i)
+    {
+        dr::InlineMemoryResource<8192> local_mem{memory};
+        pmr::unordered_map<pmr::string, int> map{&local_mem};
+
+        for (int j = 0; j < m; ++j)
+        {
+            std::to_chars(buf, buf + std::size(buf), j);
+            map[buf] = j;
+        }
+
+        std::to_chars(buf, buf + std::size(buf), i);
+        maps[buf] = std::move(map);
+    }
+}
+
+// Same as vector_test_1 but with a vector that tries to grow in place
+void expandable_vector_test_1(pmr::memory_resource* memory, int n)
+{
+    dr::ExpandableVector<int> vec{memory};
+
+    for (int i = 0; i < n; ++i)
+        vec.push_back(i);
+}
+
+// Same as vector_test_2 but with vectors that try to grow in place
+void expandable_vector_test_2(pmr::memory_resource* memory, int size)
+{
+    const int n = std::max(1, size / inner_size);
+    constexpr int m = inner_size;
+
+    dr::ExpandableVector<dr::ExpandableVector<int>> vecs{memory};
+
+    for (int i = 0; i < n; ++i)
+    {
+        dr::ExpandableVector<int> vec{memory};
+
+        for (int j = 0; j < m; ++j)
+            vec.push_back(j);
+
+        vecs.push_back(std::move(vec));
+    }
+}
+
+// If given, release is called before each run to free what resources that grow left behind
+void do_tests(pmr::memory_resource* memory, const std::function<void()>& release = nullptr)
+{
+    auto do_test = [&](void (*test)(pmr::memory_resource*, int), const char* context) {
+        if (!dr::test_selected(context))
+            return;
 
-        const auto elapsed = std::chrono::duration_cast<Duration>(Clock::now() - start);
-        fmt::print("{} ({} ms)\n", context, static_cast<long long>(elapsed.count()));
+        // Labels the allocations the instrumentation traces
+        const dr::TraceScope trace_scope{context};
+
+        const int size = dr::test_size(default_size);
+        const dr::BenchmarkResult result = dr::run_benchmark([&] { test(memory, size); }, release);
+        fmt::print("{} ({})\n", context, dr::format_summary(result));
+        dr::print_counters(result);
+        dr::add_result(context, size, result);
     };
 
     do_test(vector_test_1, "vector test 1");
@@ -192,13 +280,76 @@ void do_tests(pmr::memory_resource* memory)
     do_test(unordered_map_test_2, "unordered map test 2");
 }
 
-void report(DebugMemoryResource* memory)
+// Runs tests with and without inline resources, reporting the upstream allocations made by each
+void do_inline_tests(dr::DebugMemoryResource* memory)
+{
+    auto do_test = [=](void (*test)(pmr::memory_resource*, int), const char* context) {
+        if (!dr::test_selected(context))
+            return;
+
+        const int size = dr::test_size(default_size);
+        const std::size_t start_allocs = memory->num_allocs;
+        const dr::BenchmarkResult result = dr::run_benchmark([&] { test(memory, size); });
+
+        fmt::print(
+            "{} ({}, {} allocs/run)\n",
+            context,
+            dr::format_summary(result),
+            (memory->num_allocs - start_allocs) / dr::total_runs(result));
+
+        dr::print_counters(result);
+        dr::add_result(context, size, result);
+    };
+
+    do_test(vector_test_2, "vector test 2");
+    do_test(vector_test_2_inline, "vector test 2 inline");
+    do_test(unordered_map_test_2, "unordered map test 2");
+    do_test(unordered_map_test_2_inline, "unordered map test 2 inline");
+}
+
+// Runs the vector tests with pmr::vector and with ExpandableVector, reporting the upstream
+// allocations made by each. Each test gets a fresh resource so that space retained by one test
+// doesn't benefit the next.
+template <typename Resource>
+void do_vector_tests(dr::DebugMemoryResource* upstream)
+{
+    auto do_test = [=](void (*test)(pmr::memory_resource*, int), const char* context) {
+        if (!dr::test_selected(context))
+            return;
+
+        const int size = dr::test_size(default_size);
+        const std::size_t start_allocs = upstream->num_allocs;
+        dr::BenchmarkResult result{};
+
+        {
+            Resource memory{upstream};
+            result = dr::run_benchmark([&] { test(&memory, size); });
+        }
+
+        fmt::print(
+            "{} ({}, {:.1f} upstream allocs/run)\n",
+            context,
+            dr::format_summary(result),
+            double(upstream->num_allocs - start_allocs) / dr::total_runs(result));
+
+        dr::print_counters(result);
+        dr::add_result(context, size, result);
+    };
+
+    do_test(vector_test_1, "vector test 1");
+    do_test(expandable_vector_test_1, "expandable vector test 1");
+    do_test(vector_test_2, "vector test 2");
+    do_test(expandable_vector_test_2, "expandable vector test 2");
+}
+
+void report(dr::DebugMemoryResource* memory)
 {
     if (memory != nullptr)
     {
         fmt::print("num allocs: {}\n", memory->num_allocs);
         fmt::print("num deallocs: {}\n", memory->num_deallocs);
         fmt::print("max bytes: {}\n", memory->max_bytes);
+        dr::print_histograms(*memory);
     }
     else
     {
@@ -210,29 +361,47 @@ void report(DebugMemoryResource* memory)
     fmt::print("\n");
 }
 
+void report(const dr::ConcurrentDebugMemoryResource& memory)
+{
+    fmt::print("num allocs: {}\n", memory.num_allocs());
+    fmt::print("num deallocs: {}\n", memory.num_deallocs());
+    fmt::print("max bytes: {}\n", memory.max_bytes());
+    fmt::print("\n");
+}
+
 void no_resource_test()
 {
-    fmt::print("no resource\n---\n");
+    if (!dr::begin_stack("no resource"))
+        return;
+
     do_tests(nullptr);
     report(nullptr);
 }
 
 void default_resource_test()
 {
-    fmt::print("default resource\n---\n");
-    DebugMemoryResource db_mem{pmr::new_delete_resource()};
-    do_tests(&db_mem);
+    if (!dr::begin_stack("default resource"))
+        return;
+
+    dr::DebugMemoryResource db_mem{pmr::new_delete_resource(), dr::Profiling::off};
+    dr::Instrumentation inst_mem{&db_mem};
+    do_tests(inst_mem.top);
+    dr::print_latency(inst_mem.latency);
     report(&db_mem);
 }
 
 void buffer_resource_test()
 {
-    fmt::print("buffer resource\n---\n");
-    DebugMemoryResource db_mem{pmr::new_delete_resource()};
+    if (!dr::begin_stack("buffer resource"))
+        return;
+
+    dr::DebugMemoryResource db_mem{pmr::new_delete_resource(), dr::Profiling::off};
 
     {
         pmr::monotonic_buffer_resource buf_mem{&db_mem};
-        do_tests(&buf_mem);
+        dr::Instrumentation inst_mem{&buf_mem};
+        do_tests(inst_mem.top, [&] { buf_mem.release(); });
+        dr::print_instrumentation(inst_mem, db_mem);
     }
 
     report(&db_mem);
@@ -240,12 +409,63 @@ void buffer_resource_test()
 
 void pool_resource_test()
 {
-    fmt::print("pool resource\n---\n");
-    DebugMemoryResource db_mem{pmr::new_delete_resource()};
+    if (!dr::begin_stack("pool resource"))
+        return;
+
+    dr::DebugMemoryResource db_mem{pmr::new_delete_resource(), dr::Profiling::off};
 
     {
         pmr::unsynchronized_pool_resource pool_mem{&db_mem};
-        do_tests(&pool_mem);
+        dr::Instrumentation inst_mem{&pool_mem};
+        do_tests(inst_mem.top);
+        dr::print_instrumentation(inst_mem, db_mem);
+    }
+
+    report(&db_mem);
+}
+
+void slab_resource_test()
+{
+    if (!dr::begin_stack("slab resource"))
+        return;
+
+    dr::DebugMemoryResource db_mem{pmr::new_delete_resource(), dr::Profiling::off};
+
+    {
+        dr::SlabMemoryResource slab_mem{&db_mem};
+        dr::Instrumentation inst_mem{&slab_mem};
+        do_tests(inst_mem.top);
+        dr::print_instrumentation(inst_mem, db_mem);
+    }
+
+    report(&db_mem);
+}
+
+void inline_resource_test()
+{
+    if (!dr::begin_stack("inline resource"))
+        return;
+
+    dr::DebugMemoryResource db_mem{pmr::new_delete_resource(), dr::Profiling::off};
+    do_inline_tests(&db_mem);
+    report(&db_mem);
+}
+
+// Large enough for the peak footprint of the tests
+constexpr std::size_t tlsf_capacity = std::size_t{64} << 20;
+
+void tlsf_resource_test()
+{
+    if (!dr::begin_stack("tlsf resource"))
+        return;
+
+    dr::DebugMemoryResource db_mem{pmr::new_delete_resource(), dr::Profiling::off};
+
+    {
+        dr::TlsfMemoryResource tlsf_mem{tlsf_capacity, &db_mem};
+        dr::Instrumentation inst_mem{&tlsf_mem};
+        do_tests(inst_mem.top);
+        dr::print_instrumentation(inst_mem, db_mem);
     }
 
     report(&db_mem);
@@ -253,13 +473,17 @@ void pool_resource_test()
 
 void pool_backed_buffer_resource_test()
 {
-    fmt::print("pool backed buffer resource\n---\n");
-    DebugMemoryResource db_mem{pmr::new_delete_resource()};
+    if (!dr::begin_stack("pool backed buffer resource"))
+        return;
+
+    dr::DebugMemoryResource db_mem{pmr::new_delete_resource(), dr::Profiling::off};
 
     {
         pmr::unsynchronized_pool_resource pool_mem{&db_mem};
         pmr::monotonic_buffer_resource buf_mem{&pool_mem};
-        do_tests(&buf_mem);
+        dr::Instrumentation inst_mem{&buf_mem};
+        do_tests(inst_mem.top, [&] { buf_mem.release(); pool_mem.release(); });
+        dr::print_instrumentation(inst_mem, db_mem);
     }
 
     report(&db_mem);
@@ -267,21 +491,470 @@ void pool_backed_buffer_resource_test()
 
 void buffer_backed_pool_resource_test()
 {
-    fmt::print("buffer backed pool resource\n---\n");
-    DebugMemoryResource db_mem{pmr::new_delete_resource()};
+    if (!dr::begin_stack("buffer backed pool resource"))
+        return;
+
+    dr::DebugMemoryResource db_mem{pmr::new_delete_resource(), dr::Profiling::off};
 
     {
         pmr::monotonic_buffer_resource buf_mem{&db_mem};
         pmr::unsynchronized_pool_resource pool_mem{&buf_mem};
-        do_tests(&pool_mem);
+        dr::Instrumentation inst_mem{&pool_mem};
+        do_tests(inst_mem.top, [&] { pool_mem.release(); buf_mem.release(); });
+        dr::print_instrumentation(inst_mem, db_mem);
     }
 
     report(&db_mem);
 }
 
-} // namespace
+// Compares pmr::vector against ExpandableVector on resources with and without in-place growth
+void expandable_vector_tests()
+{
+    if (dr::begin_stack("default resource (vector tests)"))
+    {
+        dr::DebugMemoryResource db_mem{pmr::new_delete_resource(), dr::Profiling::off};
+        do_vector_tests<dr::DebugMemoryResource>(&db_mem);
+        report(&db_mem);
+    }
+
+    if (dr::begin_stack("slab resource (vector tests)"))
+    {
+        dr::DebugMemoryResource db_mem{pmr::new_delete_resource(), dr::Profiling::off};
+        do_vector_tests<dr::SlabMemoryResource>(&db_mem);
+        report(&db_mem);
+    }
+
+    if (dr::begin_stack("arena resource (vector tests)"))
+    {
+        dr::DebugMemoryResource db_mem{pmr::new_delete_resource(), dr::Profiling::off};
+        do_vector_tests<dr::ArenaMemoryResource>(&db_mem);
+        report(&db_mem);
+    }
+}
+
+long page_faults()
+{
+    rusage usage{};
+    getrusage(RUSAGE_SELF, &usage);
+    return usage.ru_minflt + usage.ru_majflt;
+}
+
+// Capacity of the huge page arenas. Larger requests fall back to new/delete.
+constexpr std::size_t huge_page_capacity = std::size_t{256} << 20;
+
+void huge_page_buffer_resource_test(const char* context, bool huge_pages, bool prefault)
+{
+    if (!dr::begin_stack(context))
+        return;
+
+    const long start_faults = page_faults();
+
+    {
+        dr::HugePageMemoryResource huge_mem{huge_pages ? huge_page_capacity : 0, prefault};
+        dr::DebugMemoryResource db_mem{&huge_mem, dr::Profiling::off};
+
+        {
+            pmr::monotonic_buffer_resource buf_mem{&db_mem};
+            dr::Instrumentation inst_mem{&buf_mem};
+            do_tests(inst_mem.top, [&] { buf_mem.release(); });
+            dr::print_instrumentation(inst_mem, db_mem);
+        }
+
+        fmt::print("page faults: {}\n", page_faults() - start_faults);
+        report(&db_mem);
+    }
+}
+
+void huge_page_pool_backed_buffer_resource_test(const char* context, bool huge_pages, bool prefault)
+{
+    if (!dr::begin_stack(context))
+        return;
+
+    const long start_faults = page_faults();
+
+    {
+        dr::HugePageMemoryResource huge_mem{huge_pages ? huge_page_capacity : 0, prefault};
+        dr::DebugMemoryResource db_mem{&huge_mem, dr::Profiling::off};
+
+        {
+            pmr::unsynchronized_pool_resource pool_mem{&db_mem};
+            pmr::monotonic_buffer_resource buf_mem{&pool_mem};
+            dr::Instrumentation inst_mem{&buf_mem};
+            do_tests(inst_mem.top, [&] { buf_mem.release(); pool_mem.release(); });
+            dr::print_instrumentation(inst_mem, db_mem);
+        }
+
+        fmt::print("page faults: {}\n", page_faults() - start_faults);
+        report(&db_mem);
+    }
+}
+
+void huge_page_tests()
+{
+    huge_page_buffer_resource_test("buffer resource", false, false);
+    huge_page_buffer_resource_test("huge page buffer resource", true, false);
+    huge_page_buffer_resource_test("prefaulted huge page buffer resource", true, true);
+
+    huge_page_pool_backed_buffer_resource_test("pool backed buffer resource", false, false);
+    huge_page_pool_backed_buffer_resource_test("huge page pool backed buffer resource", true, false);
+    huge_page_pool_backed_buffer_resource_test("prefaulted huge page pool backed buffer resource", true, true);
+}
+
+// Allocates blocks of random sizes into a fixed number of slots, freeing whatever was in the
+// slot before. Reports percentiles of the time taken by each allocation.
+void allocation_latency_test(pmr::memory_resource* memory, const char* context)
+{
+    using Clock = std::chrono::steady_clock;
+    using Duration = std::chrono::nanoseconds;
+
+    constexpr int n = 100000;
+    constexpr int num_slots = 4096;
+
+    std::minstd_rand rng{1};
+    std::vector<std::pair<void*, std::size_t>> slots(num_slots, {nullptr, 0});
+    std::vector<std::int64_t> latencies{};
+    latencies.reserve(n);
+
+    for (int i = 0; i < n; ++i)
+    {
+        auto& [ptr, size] = slots[rng() % num_slots];
+        if (ptr != nullptr) memory->deallocate(ptr, size);
+        size = 16 + rng() % (std::size_t{16} << (rng() % 8));
+
+        const auto start = Clock::now();
+        ptr = memory->allocate(size);
+        latencies.push_back(std::chrono::duration_cast<Duration>(Clock::now() - start).count());
+    }
+
+    for (auto& [ptr, size] : slots)
+    {
+        if (ptr != nullptr) memory->deallocate(ptr, size);
+    }
+
+    std::sort(latencies.begin(), latencies.end());
+    auto percentile = [&](double p) { return latencies[std::size_t(p * (latencies.size() - 1))]; };
+
+    fmt::print(
+        "{} (p50 {} ns, p99 {} ns, p99.9 {} ns, max {} ns)\n",
+        context,
+        percentile(0.5),
+        percentile(0.99),
+        percentile(0.999),
+        latencies.back());
+}
+
+void allocation_latency_tests()
+{
+    if (!dr::begin_stack("allocation latency"))
+        return;
+
+    allocation_latency_test(pmr::new_delete_resource(), "default resource");
+
+    {
+        pmr::unsynchronized_pool_resource pool_mem{};
+        allocation_latency_test(&pool_mem, "pool resource");
+    }
+
+    {
+        pmr::monotonic_buffer_resource buf_mem{};
+        allocation_latency_test(&buf_mem, "buffer resource");
+    }
+
+    {
+        pmr::monotonic_buffer_resource buf_mem{};
+        pmr::unsynchronized_pool_resource pool_mem{&buf_mem};
+        allocation_latency_test(&pool_mem, "buffer backed pool resource");
+    }
+
+    {
+        pmr::unsynchronized_pool_resource pool_mem{};
+        pmr::monotonic_buffer_resource buf_mem{&pool_mem};
+        allocation_latency_test(&buf_mem, "pool backed buffer resource");
+    }
+
+    {
+        dr::SlabMemoryResource slab_mem{pmr::new_delete_resource()};
+        allocation_latency_test(&slab_mem, "slab resource");
+    }
+
+    {
+        dr::TlsfMemoryResource tlsf_mem{tlsf_capacity};
+        allocation_latency_test(&tlsf_mem, "tlsf resource");
+    }
+
+    // Takes page faults out of the picture
+    {
+        dr::HugePageMemoryResource huge_mem{tlsf_capacity, true};
+        dr::TlsfMemoryResource tlsf_mem{tlsf_capacity, &huge_mem};
+        allocation_latency_test(&tlsf_mem, "prefaulted tlsf resource");
+    }
 
-int main()
+    fmt::print("\n");
+}
+
+void alloc_dealloc_loop(pmr::memory_resource* memory, int n)
+{
+    constexpr int batch = 64;
+    void* ptrs[batch]{};
+
+    for (int i = 0; i < n; i += batch)
+    {
+        for (int j = 0; j < batch; ++j)
+            ptrs[j] = memory->allocate(16 + 8 * (j % 8));
+
+        for (int j = 0; j < batch; ++j)
+            memory->deallocate(ptrs[j], 16 + 8 * (j % 8));
+    }
+}
+
+// Returns the average time per allocate/deallocate pair in nanoseconds
+double threaded_alloc_dealloc(pmr::memory_resource* memory, int num_threads)
+{
+    using Clock = std::chrono::high_resolution_clock;
+    using Duration = std::chrono::duration<double, std::nano>;
+
+    constexpr int n = 1 << 18;
+    std::vector<std::thread> threads{};
+
+    const auto start = Clock::now();
+
+    for (int i = 0; i < num_threads; ++i)
+        threads.emplace_back(alloc_dealloc_loop, memory, n);
+
+    for (auto& t : threads)
+        t.join();
+
+    const auto elapsed = std::chrono::duration_cast<Duration>(Clock::now() - start);
+    return elapsed.count() / (double(n) * num_threads);
+}
+
+void concurrent_debug_resource_test()
+{
+    if (!dr::begin_stack("concurrent debug resource"))
+        return;
+
+    pmr::synchronized_pool_resource pool_mem{pmr::new_delete_resource()};
+    dr::ConcurrentDebugMemoryResource db_mem{&pool_mem};
+
+    for (const int num_threads : {1, 4, 16})
+    {
+        const double base = threaded_alloc_dealloc(&pool_mem, num_threads);
+        const double debug = threaded_alloc_dealloc(&db_mem, num_threads);
+        fmt::print(
+            "{} thread(s) ({:.1f} ns/op, {:.1f} ns/op without debug)\n",
+            num_threads,
+            debug,
+            base);
+    }
+
+    report(db_mem);
+}
+
+struct Block
+{
+    void* ptr;
+    std::size_t size;
+};
+
+// Hands batches of blocks from a producer thread to a consumer thread
+struct BlockQueue
+{
+    std::mutex mutex{};
+    std::condition_variable cond{};
+    std::deque<std::vector<Block>> batches{};
+    bool done{};
+
+    void push(std::vector<Block>&& batch)
+    {
+        {
+            std::lock_guard<std::mutex> lock{mutex};
+            batches.push_back(std::move(batch));
+        }
+
+        cond.notify_one();
+    }
+
+    void close()
+    {
+        {
+            std::lock_guard<std::mutex> lock{mutex};
+            done = true;
+        }
+
+        cond.notify_one();
+    }
+
+    // Returns false once the queue is closed and empty
+    bool pop(std::vector<Block>& batch)
+    {
+        std::unique_lock<std::mutex> lock{mutex};
+        cond.wait(lock, [&] { return done || !batches.empty(); });
+
+        if (batches.empty())
+            return false;
+
+        batch = std::move(batches.front());
+        batches.pop_front();
+        return true;
+    }
+};
+
+void produce(pmr::memory_resource* memory, BlockQueue* queue, int n)
+{
+    constexpr int batch_size = 256;
+
+    for (int i = 0; i < n; i += batch_size)
+    {
+        std::vector<Block> batch{};
+        batch.reserve(batch_size);
+
+        for (int j = 0; j < batch_size; ++j)
+        {
+            const std::size_t size = 16 << (j % 5);
+            batch.push_back({memory->allocate(size), size});
+        }
+
+        queue->push(std::move(batch));
+    }
+
+    queue->close();
+}
+
+void consume(pmr::memory_resource* memory, BlockQueue* queue)
+{
+    std::vector<Block> batch{};
+
+    while (queue->pop(batch))
+    {
+        for (const Block& b : batch)
+            memory->deallocate(b.ptr, b.size);
+    }
+}
+
+// Returns the average time per block allocated on a producer and freed on a consumer in
+// nanoseconds
+double producer_consumer(pmr::memory_resource* memory, int num_pairs)
+{
+    using Clock = std::chrono::high_resolution_clock;
+    using Duration = std::chrono::duration<double, std::nano>;
+
+    constexpr int n = 1 << 17;
+    std::deque<BlockQueue> queues(num_pairs);
+    std::vector<std::thread> threads{};
+
+    const auto start = Clock::now();
+
+    for (auto& q : queues)
+    {
+        threads.emplace_back(produce, memory, &q, n);
+        threads.emplace_back(consume, memory, &q);
+    }
+
+    for (auto& t : threads)
+        t.join();
+
+    const auto elapsed = std::chrono::duration_cast<Duration>(Clock::now() - start);
+    return elapsed.count() / (double(n) * num_pairs);
+}
+
+void producer_consumer_test(pmr::memory_resource* memory)
+{
+    for (const int num_pairs : {1, 2, 4})
+    {
+        fmt::print(
+            "producer consumer test, {} pair(s) ({:.1f} ns/block)\n",
+            num_pairs,
+            producer_consumer(memory, num_pairs));
+    }
+}
+
+void synchronized_pool_resource_test()
+{
+    if (!dr::begin_stack("synchronized pool resource"))
+        return;
+
+    dr::ConcurrentDebugMemoryResource db_mem{pmr::new_delete_resource()};
+
+    {
+        pmr::synchronized_pool_resource pool_mem{&db_mem};
+        producer_consumer_test(&pool_mem);
+    }
+
+    report(db_mem);
+}
+
+void thread_caching_resource_test()
+{
+    if (!dr::begin_stack("thread caching resource"))
+        return;
+
+    dr::ConcurrentDebugMemoryResource db_mem{pmr::new_delete_resource()};
+
+    {
+        dr::ThreadCachingMemoryResource cache_mem{&db_mem};
+        producer_consumer_test(&cache_mem);
+    }
+
+    report(db_mem);
+}
+
+// Profiles block lifetimes of each test on its own and recommends a resource for it
+void lifetime_tests()
+{
+    auto do_test = [](void (*test)(pmr::memory_resource*, int), const char* context) {
+        if (!dr::test_selected(context))
+            return;
+
+        fmt::print("{}\n---\n", context);
+        dr::DebugMemoryResource db_mem{pmr::new_delete_resource()};
+        db_mem.lifetimes = std::make_unique<dr::LifetimeProfiler>();
+        test(&db_mem, default_size);
+        dr::print_lifetimes(db_mem);
+        fmt::print("\n");
+    };
+
+    do_test(vector_test_1, "vector test 1");
+    do_test(vector_test_2, "vector test 2");
+    do_test(unordered_map_test_1, "unordered map test 1");
+    do_test(unordered_map_test_2, "unordered map test 2");
+}
+
+// Runs each test once, recording its allocations for pmr-replay. Exits if the trace can't be
+// written.
+void record_tests(const char* path)
+{
+    std::FILE* const file = std::fopen(path, "wb");
+
+    if (file == nullptr)
+    {
+        fmt::print(stderr, "failed to write {}\n", path);
+        std::exit(EXIT_FAILURE);
+    }
+
+    dr::RecordingMemoryResource rec_mem{pmr::new_delete_resource(), file};
+
+    auto do_test = [&](void (*test)(pmr::memory_resource*, int), const char* context) {
+        if (dr::test_selected(context))
+            test(&rec_mem, default_size);
+    };
+
+    do_test(vector_test_1, "vector test 1");
+    do_test(vector_test_2, "vector test 2");
+    do_test(unordered_map_test_1, "unordered map test 1");
+    do_test(unordered_map_test_2, "unordered map test 2");
+
+    // Flush before closing so the destructor has nothing left to write
+    const bool flushed = rec_mem.flush();
+
+    if (std::fclose(file) != 0 || !flushed)
+    {
+        fmt::print(stderr, "failed to write {}\n", path);
+        std::exit(EXIT_FAILURE);
+    }
+}
+
+// Runs the tests that take a size
+void sized_tests()
 {
     no_resource_test();
 
@@ -289,9 +962,153 @@ int main()
     {
         default_resource_test();
         pool_resource_test();
+        slab_resource_test();
+        tlsf_resource_test();
         buffer_resource_test();
         buffer_backed_pool_resource_test();
         pool_backed_buffer_resource_test();
+        inline_resource_test();
+        expandable_vector_tests();
+    }
+}
+
+// Runs every test except those selected by options
+void all_tests()
+{
+    sized_tests();
+    allocation_latency_tests();
+
+    // These share a resource across threads
+    {
+        concurrent_debug_resource_test();
+        synchronized_pool_resource_test();
+        thread_caching_resource_test();
+    }
+}
+
+} // namespace
+
+int main(int argc, char* argv[])
+{
+    const dr::Options options = dr::parse_options(argc, argv);
+
+    dr::StackSampler sampler{
+        options.sample_bytes ? dr::StackSampler::Unit::bytes : dr::StackSampler::Unit::allocations,
+        options.sample_interval};
+
+    if (options.folded != nullptr)
+        dr::set_stack_sampler(&sampler);
+
+    dr::HeapProfiler heap_profiler{options.heap_sample_bytes};
+
+    if (options.heap_profile != nullptr)
+    {
+        dr::set_heap_profiler(&heap_profiler);
+        dr::dump_heap_profile_on_signal(options.heap_profile);
+    }
+
+    std::unique_ptr<dr::Tracer> tracer{};
+
+    if (options.trace != nullptr)
+    {
+        tracer = std::make_unique<dr::Tracer>();
+        dr::set_tracer(tracer.get());
+    }
+
+    std::unique_ptr<dr::StatsPublisher> publisher{};
+
+    if (options.stats)
+    {
+        publisher = std::make_unique<dr::StatsPublisher>();
+
+        if (!publisher->valid())
+        {
+            fmt::print(stderr, "failed to create stats segment\n");
+            return 1;
+        }
+
+        dr::set_stats_publisher(publisher.get());
+    }
+
+    dr::set_stack_filter(options.stacks);
+    dr::set_test_filter(options.tests);
+    std::unique_ptr<dr::PerfCounters> counters{};
+
+    if (options.perf)
+    {
+        counters = std::make_unique<dr::PerfCounters>();
+
+        if (!counters->valid())
+        {
+            fmt::print(stderr, "perf counters unavailable: {}\n", dr::perf_error_message(counters->error));
+            counters.reset();
+        }
+        else
+        {
+            std::string missing{};
+
+            for (std::size_t i = 0; i < dr::PerfCounters::num_events; ++i)
+            {
+                if (!counters->available(i))
+                    missing += fmt::format("{}{}", missing.empty() ? "" : ", ", dr::PerfCounters::names[i]);
+            }
+
+            if (!missing.empty())
+                fmt::print(stderr, "perf counters unavailable: {} ({})\n", missing, dr::perf_error_message(counters->error));
+
+            dr::set_perf_counters(counters.get());
+        }
+    }
+
+    dr::set_utilization_metrics(options.utilization);
+    dr::set_latency_timing(options.latency);
+    dr::set_check_sample_rate(options.check_sample_rate);
+
+    if (options.huge_pages)
+        huge_page_tests();
+    else if (options.lifetimes)
+        lifetime_tests();
+    else if (options.record != nullptr)
+        record_tests(options.record);
+    else if (options.sweep)
+        dr::sweep_tests(sized_tests, options.sizes.empty() ? sweep_sizes : options.sizes);
+    else
+        all_tests();
+
+    if (options.folded != nullptr && !sampler.write_folded(options.folded))
+    {
+        fmt::print(stderr, "failed to write {}\n", options.folded);
+        return 1;
+    }
+
+    if (options.heap_profile != nullptr && !heap_profiler.write(options.heap_profile))
+    {
+        fmt::print(stderr, "failed to write {}\n", options.heap_profile);
+        return 1;
+    }
+
+    if (tracer != nullptr && !tracer->write_chrome_trace(options.trace))
+    {
+        fmt::print(stderr, "failed to write {}\n", options.trace);
+        return 1;
+    }
+
+    if (options.json != nullptr && !dr::write_json(options.json, argv[0]))
+    {
+        fmt::print(stderr, "failed to write {}\n", options.json);
+        return 1;
+    }
+
+    if (options.csv != nullptr && !dr::write_csv(options.csv, argv[0]))
+    {
+        fmt::print(stderr, "failed to write {}\n", options.csv);
+        return 1;
+    }
+
+    if (dr::check_violations() > 0)
+    {
+        fmt::print(stderr, "{} contract violations\n", dr::check_violations());
+        return 1;
     }
 
     return 0;
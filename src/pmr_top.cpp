@@ -0,0 +1,314 @@
+#include <atomic>
+#include <charconv>
+#include <chrono>
+#include <cerrno>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <unordered_map>
+
+#include <fcntl.h>
+#include <signal.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+#include <fmt/core.h>
+
+#include "stats_segment.hpp"
+
+namespace
+{
+
+struct Snapshot
+{
+    std::uint64_t id;
+    std::uint64_t num_allocs;
+    std::uint64_t num_deallocs;
+    std::uint64_t curr_bytes;
+    std::uint64_t max_bytes;
+    std::uint64_t size_counts[dr::StatsSlot::num_buckets];
+    char name[dr::StatsSlot::name_size];
+};
+
+// Copies a slot, retrying while its writer is mid-update. Returns false if the slot is unused or
+// no consistent copy was seen.
+bool read_slot(const dr::StatsSlot& slot, Snapshot& result)
+{
+    constexpr int max_attempts = 100;
+
+    for (int i = 0; i < max_attempts; ++i)
+    {
+        if (slot.used.load(std::memory_order_acquire) == 0)
+            return false;
+
+        const std::uint32_t seq = slot.seq.load(std::memory_order_acquire);
+
+        if (seq % 2 != 0)
+            continue;
+
+        result.id = slot.id.load(std::memory_order_relaxed);
+        result.num_allocs = slot.num_allocs.load(std::memory_order_relaxed);
+        result.num_deallocs = slot.num_deallocs.load(std::memory_order_relaxed);
+        result.curr_bytes = slot.curr_bytes.load(std::memory_order_relaxed);
+        result.max_bytes = slot.max_bytes.load(std::memory_order_relaxed);
+
+        for (std::size_t j = 0; j < dr::StatsSlot::num_buckets; ++j)
+            result.size_counts[j] = slot.size_counts[j].load(std::memory_order_relaxed);
+
+        std::memcpy(result.name, slot.name, sizeof(result.name));
+        std::atomic_thread_fence(std::memory_order_acquire);
+
+        if (slot.seq.load(std::memory_order_relaxed) == seq)
+        {
+            result.name[sizeof(result.name) - 1] = '\0';
+            return true;
+        }
+    }
+
+    return false;
+}
+
+std::string read_label(const dr::StatsSegment& segment)
+{
+    constexpr int max_attempts = 100;
+    char label[dr::StatsSegment::label_size];
+
+    for (int i = 0; i < max_attempts; ++i)
+    {
+        const std::uint32_t seq = segment.label_seq.load(std::memory_order_acquire);
+
+        if (seq % 2 != 0)
+            continue;
+
+        std::memcpy(label, segment.label, sizeof(label));
+        std::atomic_thread_fence(std::memory_order_acquire);
+
+        if (segment.label_seq.load(std::memory_order_relaxed) == seq)
+        {
+            label[sizeof(label) - 1] = '\0';
+            return label;
+        }
+    }
+
+    return {};
+}
+
+// Segments of processes that were killed are left behind, so check the process too
+bool publisher_alive(long pid)
+{
+    const bool running = kill(static_cast<pid_t>(pid), 0) == 0 || errno == EPERM;
+    return running && std::filesystem::exists("/dev/shm" + dr::stats_segment_name(pid));
+}
+
+// Returns the pid of a running process publishing stats, or 0 if there is none
+long find_publisher()
+{
+    std::error_code error{};
+
+    for (const auto& entry : std::filesystem::directory_iterator{"/dev/shm", error})
+    {
+        const std::string name = entry.path().filename().string();
+        constexpr std::string_view prefix = "pmr-stats.";
+
+        if (name.compare(0, prefix.size(), prefix) != 0)
+            continue;
+
+        const long pid = std::strtol(name.c_str() + prefix.size(), nullptr, 10);
+
+        if (pid > 0 && publisher_alive(pid))
+            return pid;
+    }
+
+    return 0;
+}
+
+const dr::StatsSegment* open_segment(long pid)
+{
+    const int fd = shm_open(dr::stats_segment_name(pid).c_str(), O_RDONLY, 0);
+
+    if (fd < 0)
+        return nullptr;
+
+    void* const ptr = mmap(nullptr, sizeof(dr::StatsSegment), PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+
+    if (ptr == MAP_FAILED)
+        return nullptr;
+
+    const auto* const segment = static_cast<const dr::StatsSegment*>(ptr);
+
+    if (std::memcmp(segment->header, dr::StatsSegment::magic, sizeof(segment->header)) != 0 ||
+        segment->segment_version != dr::StatsSegment::version)
+    {
+        munmap(ptr, sizeof(dr::StatsSegment));
+        return nullptr;
+    }
+
+    return segment;
+}
+
+// Prints one line per resource plus its non-empty size classes. Allocation rates are computed
+// against the previous refresh.
+void print_segment(
+    const dr::StatsSegment& segment,
+    double seconds,
+    std::unordered_map<std::uint64_t, std::uint64_t>& prev_allocs)
+{
+    fmt::print("pid {}  test: {}\n\n", segment.pid, read_label(segment));
+    fmt::print("{:>12} {:>12} {:>14} {:>14} {:>12}  {}\n", "allocs", "deallocs", "live bytes", "peak bytes", "allocs/s", "resource");
+
+    std::unordered_map<std::uint64_t, std::uint64_t> curr_allocs{};
+
+    for (const dr::StatsSlot& slot : segment.slots)
+    {
+        Snapshot s{};
+
+        if (!read_slot(slot, s))
+            continue;
+
+        const auto it = prev_allocs.find(s.id);
+        const double rate = it != prev_allocs.end() && seconds > 0 ? (s.num_allocs - it->second) / seconds : 0.0;
+        curr_allocs[s.id] = s.num_allocs;
+
+        // Resources that weren't named fall back to their id
+        const std::string name = s.name[0] != '\0' ? std::string{s.name} : fmt::format("#{}", s.id);
+
+        fmt::print(
+            "{:>12} {:>12} {:>14} {:>14} {:>12.0f}  {}\n",
+            s.num_allocs,
+            s.num_deallocs,
+            s.curr_bytes,
+            s.max_bytes,
+            rate,
+            name);
+
+        std::string sizes{};
+
+        for (std::size_t i = 0; i < dr::StatsSlot::num_buckets; ++i)
+        {
+            if (s.size_counts[i] != 0)
+                sizes += fmt::format(" <={}:{}", std::size_t{1} << i, s.size_counts[i]);
+        }
+
+        if (!sizes.empty())
+            fmt::print("{:>12}{}\n", "", sizes);
+    }
+
+    prev_allocs = std::move(curr_allocs);
+}
+
+[[noreturn]] void usage(const char* program, int status)
+{
+    fmt::print(
+        stderr,
+        "usage: {} [pid] [options]\n"
+        "\n"
+        "Shows live counters of a pmr-test or pmr-eigen-test run with --stats (the first found by\n"
+        "default) until it exits\n"
+        "\n"
+        "options:\n"
+        "  --interval <ms>  refresh interval (default 1000)\n"
+        "  --once           print once and exit\n"
+        "  --help           show this message\n",
+        program);
+
+    std::exit(status);
+}
+
+// Parses a positive integer, exiting if it's invalid
+long parse_count(const char* program, std::string_view value)
+{
+    long result{};
+    const auto [end, error] = std::from_chars(value.data(), value.data() + value.size(), result);
+
+    if (error != std::errc{} || end != value.data() + value.size() || result <= 0)
+        usage(program, EXIT_FAILURE);
+
+    return result;
+}
+
+} // namespace
+
+int main(int argc, char* argv[])
+{
+    long pid{};
+    long interval_ms = 1000;
+    bool once = false;
+
+    for (int i = 1; i < argc; ++i)
+    {
+        const std::string_view arg{argv[i]};
+
+        if (arg == "--help")
+        {
+            usage(argv[0], EXIT_SUCCESS);
+        }
+        else if (arg == "--interval")
+        {
+            if (i + 1 >= argc)
+                usage(argv[0], EXIT_FAILURE);
+
+            interval_ms = parse_count(argv[0], argv[++i]);
+        }
+        else if (arg == "--once")
+        {
+            once = true;
+        }
+        else if (pid == 0)
+        {
+            pid = parse_count(argv[0], arg);
+        }
+        else
+        {
+            usage(argv[0], EXIT_FAILURE);
+        }
+    }
+
+    if (pid == 0)
+        pid = find_publisher();
+
+    const dr::StatsSegment* const segment = pid != 0 ? open_segment(pid) : nullptr;
+
+    if (segment == nullptr)
+    {
+        fmt::print(stderr, "no stats found{}\n", pid != 0 ? fmt::format(" for pid {}", pid) : "");
+        return 1;
+    }
+
+    using Clock = std::chrono::steady_clock;
+
+    std::unordered_map<std::uint64_t, std::uint64_t> prev_allocs{};
+    auto prev_time = Clock::now();
+
+    while (true)
+    {
+        const auto now = Clock::now();
+        const double seconds = std::chrono::duration<double>(now - prev_time).count();
+        prev_time = now;
+
+        // Clear the screen and move to the top left
+        if (!once)
+            fmt::print("\x1b[H\x1b[2J");
+
+        print_segment(*segment, seconds, prev_allocs);
+
+        if (once)
+            break;
+
+        std::fflush(stdout);
+        std::this_thread::sleep_for(std::chrono::milliseconds{interval_ms});
+
+        if (!publisher_alive(pid))
+        {
+            fmt::print("pid {} exited\n", pid);
+            break;
+        }
+    }
+
+    munmap(const_cast<dr::StatsSegment*>(segment), sizeof(dr::StatsSegment));
+    return 0;
+}
@@ -0,0 +1,141 @@
+#include "recording_memory_resource.hpp"
+
+#include <cstring>
+
+namespace dr
+{
+
+RecordingMemoryResource::RecordingMemoryResource(std::pmr::memory_resource* upstream, std::FILE* file) :
+    upstream{upstream}, file{file}
+{
+    buffer.reserve(buffer_size);
+    buffer.insert(buffer.end(), std::begin(magic), std::end(magic));
+}
+
+bool RecordingMemoryResource::flush()
+{
+    if (!buffer.empty() && std::fwrite(buffer.data(), 1, buffer.size(), file) != buffer.size())
+        failed = true;
+
+    buffer.clear();
+    return !failed;
+}
+
+void RecordingMemoryResource::write_varint(std::size_t value)
+{
+    while (value >= 0x80)
+    {
+        buffer.push_back(static_cast<std::uint8_t>(value | 0x80));
+        value >>= 7;
+    }
+
+    buffer.push_back(static_cast<std::uint8_t>(value));
+}
+
+void* RecordingMemoryResource::do_allocate(std::size_t bytes, std::size_t alignment)
+{
+    void* const ptr = upstream->allocate(bytes, alignment);
+    ids[ptr] = num_allocs++;
+
+    buffer.push_back(static_cast<std::uint8_t>(__builtin_ctzll(alignment) << 1));
+    write_varint(bytes);
+
+    if (buffer.size() >= buffer_size - 16)
+        flush();
+
+    return ptr;
+}
+
+void RecordingMemoryResource::do_deallocate(void* ptr, std::size_t bytes, std::size_t alignment)
+{
+    const auto it = ids.find(ptr);
+
+    if (it != ids.end())
+    {
+        buffer.push_back(1);
+        write_varint(num_allocs - it->second);
+        ids.erase(it);
+
+        if (buffer.size() >= buffer_size - 16)
+            flush();
+    }
+
+    upstream->deallocate(ptr, bytes, alignment);
+}
+
+bool read_trace(const char* path, AllocationTrace& trace)
+{
+    std::FILE* const file = std::fopen(path, "rb");
+
+    if (file == nullptr)
+        return false;
+
+    std::vector<std::uint8_t> data{};
+    std::uint8_t chunk[64 * 1024];
+
+    for (std::size_t n; (n = std::fread(chunk, 1, sizeof(chunk), file)) > 0;)
+        data.insert(data.end(), chunk, chunk + n);
+
+    std::fclose(file);
+
+    constexpr std::size_t magic_size = sizeof(RecordingMemoryResource::magic);
+
+    if (data.size() < magic_size || std::memcmp(data.data(), RecordingMemoryResource::magic, magic_size) != 0)
+        return false;
+
+    const std::uint8_t* it = data.data() + magic_size;
+    const std::uint8_t* const end = data.data() + data.size();
+
+    auto read_varint = [&](std::size_t& value) {
+        value = 0;
+
+        for (int shift = 0; it != end && shift < 64; shift += 7)
+        {
+            const std::uint8_t byte = *it++;
+            value |= std::size_t(byte & 0x7f) << shift;
+            if ((byte & 0x80) == 0) return true;
+        }
+
+        return false;
+    };
+
+    // Sizes and alignments of allocations, looked up by deallocations, which clear allocate so a
+    // second free of the same id is rejected rather than replayed as a free of nullptr
+    std::vector<TraceOp> allocs{};
+
+    trace = {};
+
+    while (it != end)
+    {
+        const std::uint8_t tag = *it++;
+        std::size_t value{};
+
+        if (!read_varint(value))
+            return false;
+
+        if ((tag & 1) == 0)
+        {
+            const TraceOp op{true, static_cast<std::uint8_t>(tag >> 1), value, allocs.size()};
+            allocs.push_back(op);
+            trace.ops.push_back(op);
+        }
+        else
+        {
+            if (value == 0 || value > allocs.size())
+                return false;
+
+            TraceOp& alloc = allocs[allocs.size() - value];
+
+            if (!alloc.allocate)
+                return false;
+
+            alloc.allocate = false;
+            trace.ops.push_back(alloc);
+        }
+    }
+
+    trace.num_allocs = allocs.size();
+    return true;
+}
+
+} // namespace dr
@@ -0,0 +1,76 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <memory_resource>
+#include <unordered_map>
+#include <vector>
+
+namespace dr
+{
+
+// Single allocate or deallocate from a recorded trace. Allocations are numbered in the order
+// they're made, and a deallocation refers to the allocation it frees by that number.
+struct TraceOp
+{
+    bool allocate;
+    std::uint8_t alignment_log2;
+    std::size_t bytes;
+    std::size_t id;
+};
+
+struct AllocationTrace
+{
+    std::vector<TraceOp> ops{};
+    std::size_t num_allocs{};
+};
+
+// Forwards to upstream, writing every allocate and deallocate to a compact binary trace which
+// can be replayed with pmr-replay. The trace starts with a 4-byte magic followed by one record
+// per call:
+//
+//   allocate:   byte (log2(alignment) << 1), varint bytes
+//   deallocate: byte 1, varint (allocations so far - id)
+//
+// Varints are LEB128. Deallocations of blocks the resource didn't allocate aren't recorded.
+struct RecordingMemoryResource : public std::pmr::memory_resource
+{
+    static constexpr char magic[4] = {'P', 'M', 'R', '1'};
+    static constexpr std::size_t buffer_size = 64 * 1024;
+
+    std::pmr::memory_resource* upstream;
+    std::FILE* file;
+    std::unordered_map<void*, std::size_t> ids{};
+    std::size_t num_allocs{};
+    std::vector<std::uint8_t> buffer{};
+    bool failed{};
+
+    // The file must stay open for the lifetime of the resource
+    RecordingMemoryResource(std::pmr::memory_resource* upstream, std::FILE* file);
+
+    RecordingMemoryResource(const RecordingMemoryResource&) = delete;
+    RecordingMemoryResource& operator=(const RecordingMemoryResource&) = delete;
+
+    ~RecordingMemoryResource() { flush(); }
+
+    // Writes buffered records to the file. Returns false if any write has failed.
+    bool flush();
+
+    void* do_allocate(std::size_t bytes, std::size_t alignment) override;
+    void do_deallocate(void* ptr, std::size_t bytes, std::size_t alignment) override;
+
+    bool do_is_equal(const std::pmr::memory_resource& other) const noexcept override
+    {
+        return this == &other;
+    };
+
+  private:
+    void write_varint(std::size_t value);
+};
+
+// Reads a trace written by RecordingMemoryResource. Returns false if the file can't be read or
+// isn't a valid trace.
+bool read_trace(const char* path, AllocationTrace& trace);
+
+} // namespace dr
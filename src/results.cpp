@@ -0,0 +1,349 @@
+#include "results.hpp"
+
+#include <cstdio>
+#include <ctime>
+#include <fstream>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+#include <fnmatch.h>
+#include <unistd.h>
+
+#include <fmt/format.h>
+
+#include "git_commit.hpp"
+#include "perf_counters.hpp"
+
+// Set by CMake at configure time
+#ifndef PMR_BUILD_TYPE
+#define PMR_BUILD_TYPE ""
+#endif
+
+#ifndef PMR_CXX_FLAGS
+#define PMR_CXX_FLAGS ""
+#endif
+
+namespace dr
+{
+namespace
+{
+
+struct Record
+{
+    std::string stack;
+    std::string test;
+    int size;
+    BenchmarkResult result;
+};
+
+struct
+{
+    const char* stack_filter{};
+    const char* test_filter{};
+    int size{};
+    std::string stack{};
+    std::vector<Record> records{};
+} state;
+
+// Returns true if name matches any of the comma-separated globs, or if there are none
+bool matches(const char* globs, const char* name)
+{
+    if (globs == nullptr)
+        return true;
+
+    std::string_view rest{globs};
+
+    while (true)
+    {
+        const std::size_t comma = rest.find(',');
+        const std::string glob{rest.substr(0, comma)};
+
+        if (fnmatch(glob.c_str(), name, 0) == 0)
+            return true;
+
+        if (comma == std::string_view::npos)
+            return false;
+
+        rest.remove_prefix(comma + 1);
+    }
+}
+
+std::string cpu_model()
+{
+    std::ifstream cpuinfo{"/proc/cpuinfo"};
+    std::string line{};
+
+    while (std::getline(cpuinfo, line))
+    {
+        if (line.compare(0, 10, "model name") != 0)
+            continue;
+
+        const std::size_t colon = line.find(':');
+
+        if (colon != std::string::npos)
+            return line.substr(line.find_first_not_of(' ', colon + 1));
+    }
+
+    return "unknown";
+}
+
+std::string compiler()
+{
+#if defined(__clang__)
+    return "clang " __clang_version__;
+#elif defined(__GNUC__)
+    return "gcc " __VERSION__;
+#else
+    return "unknown";
+#endif
+}
+
+std::string host_name()
+{
+    char name[256]{};
+
+    if (gethostname(name, sizeof(name) - 1) != 0)
+        return "unknown";
+
+    return name;
+}
+
+std::string utc_time()
+{
+    const std::time_t now = std::time(nullptr);
+    std::tm tm{};
+    gmtime_r(&now, &tm);
+
+    char result[32];
+    std::strftime(result, sizeof(result), "%Y-%m-%dT%H:%M:%SZ", &tm);
+    return result;
+}
+
+std::string json_string(std::string_view value)
+{
+    std::string result{"\""};
+
+    for (const char c : value)
+    {
+        if (c == '"' || c == '\\')
+        {
+            result += '\\';
+            result += c;
+        }
+        else if (static_cast<unsigned char>(c) < 0x20)
+        {
+            result += fmt::format("\\u{:04x}", c);
+        }
+        else
+        {
+            result += c;
+        }
+    }
+
+    return result + '"';
+}
+
+std::string csv_string(std::string_view value)
+{
+    std::string result{"\""};
+
+    for (const char c : value)
+    {
+        if (c == '"') result += '"';
+        result += c;
+    }
+
+    return result + '"';
+}
+
+std::string_view base_name(std::string_view path)
+{
+    const std::size_t slash = path.rfind('/');
+    return slash != std::string_view::npos ? path.substr(slash + 1) : path;
+}
+
+} // namespace
+
+void set_stack_filter(const char* globs) { state.stack_filter = globs; }
+void set_test_filter(const char* globs) { state.test_filter = globs; }
+
+void sweep_tests(void (*tests)(), const std::vector<int>& sizes)
+{
+    for (const int size : sizes)
+    {
+        state.size = size;
+        tests();
+    }
+
+    state.size = 0;
+}
+
+int test_size(int default_size)
+{
+    return state.size != 0 ? state.size : default_size;
+}
+
+bool begin_stack(const char* name)
+{
+    if (!matches(state.stack_filter, name))
+        return false;
+
+    state.stack = name;
+
+    if (state.size != 0)
+        fmt::print("{} [size {}]\n---\n", name, state.size);
+    else
+        fmt::print("{}\n---\n", name);
+
+    return true;
+}
+
+const std::string& current_stack()
+{
+    return state.stack;
+}
+
+bool test_selected(const char* name)
+{
+    return matches(state.test_filter, name);
+}
+
+void add_result(const char* test, int size, const BenchmarkResult& result)
+{
+    state.records.push_back({state.stack, test, size, result});
+}
+
+bool write_json(const char* path, const char* program)
+{
+    std::FILE* const file = std::fopen(path, "w");
+
+    if (file == nullptr)
+        return false;
+
+    fmt::print(file, "{{\n");
+    fmt::print(file, "  \"context\": {{\n");
+    fmt::print(file, "    \"program\": {},\n", json_string(base_name(program)));
+    fmt::print(file, "    \"date\": {},\n", json_string(utc_time()));
+    fmt::print(file, "    \"host\": {},\n", json_string(host_name()));
+    fmt::print(file, "    \"cpu\": {},\n", json_string(cpu_model()));
+    fmt::print(file, "    \"num_cpus\": {},\n", std::thread::hardware_concurrency());
+    fmt::print(file, "    \"compiler\": {},\n", json_string(compiler()));
+    fmt::print(file, "    \"build_type\": {},\n", json_string(PMR_BUILD_TYPE));
+    fmt::print(file, "    \"flags\": {},\n", json_string(PMR_CXX_FLAGS));
+    fmt::print(file, "    \"commit\": {}\n", json_string(PMR_GIT_COMMIT));
+    fmt::print(file, "  }},\n");
+    fmt::print(file, "  \"benchmarks\": [");
+
+    for (std::size_t i = 0; i < state.records.size(); ++i)
+    {
+        const Record& record = state.records[i];
+        const BenchmarkResult& r = record.result;
+
+        fmt::print(file, "{}\n    {{\n", i == 0 ? "" : ",");
+        fmt::print(file, "      \"stack\": {},\n", json_string(record.stack));
+        fmt::print(file, "      \"test\": {},\n", json_string(record.test));
+        fmt::print(file, "      \"size\": {},\n", record.size);
+        fmt::print(file, "      \"runs\": {},\n", r.samples.size());
+        fmt::print(file, "      \"median_ns\": {:.1f},\n", r.median);
+        fmt::print(file, "      \"mad_ns\": {:.1f},\n", r.mad);
+        fmt::print(file, "      \"min_ns\": {:.1f},\n", r.min);
+        fmt::print(file, "      \"p90_ns\": {:.1f},\n", r.p90);
+        fmt::print(file, "      \"p99_ns\": {:.1f},\n", r.p99);
+        fmt::print(file, "      \"max_ns\": {:.1f},\n", r.max);
+
+        if (!r.counters.empty())
+        {
+            fmt::print(file, "      \"counters\": {{");
+
+            for (std::size_t j = 0; j < r.counters.size(); ++j)
+            {
+                fmt::print(
+                    file,
+                    "{}{}: {}",
+                    j == 0 ? "" : ", ",
+                    json_string(PerfCounters::names[j]),
+                    r.counters[j] >= 0 ? fmt::format("{:.1f}", r.counters[j]) : "null");
+            }
+
+            fmt::print(file, "}},\n");
+        }
+
+        fmt::print(file, "      \"samples_ns\": [");
+
+        for (std::size_t j = 0; j < r.samples.size(); ++j)
+            fmt::print(file, "{}{:.0f}", j == 0 ? "" : ", ", r.samples[j]);
+
+        fmt::print(file, "]\n    }}");
+    }
+
+    fmt::print(file, "\n  ]\n}}\n");
+    return std::fclose(file) == 0;
+}
+
+bool write_csv(const char* path, const char* program)
+{
+    std::FILE* const file = std::fopen(path, "w");
+
+    if (file == nullptr)
+        return false;
+
+    // Metadata is repeated on each row so rows from different runs can be concatenated
+    const std::string metadata = fmt::format(
+        "{},{},{},{},{},{},{},{},{}",
+        csv_string(base_name(program)),
+        csv_string(utc_time()),
+        csv_string(host_name()),
+        csv_string(cpu_model()),
+        std::thread::hardware_concurrency(),
+        csv_string(compiler()),
+        csv_string(PMR_BUILD_TYPE),
+        csv_string(PMR_CXX_FLAGS),
+        csv_string(PMR_GIT_COMMIT));
+
+    fmt::print(
+        file,
+        "program,date,host,cpu,num_cpus,compiler,build_type,flags,commit,"
+        "stack,test,size,runs,median_ns,mad_ns,min_ns,p90_ns,p99_ns,max_ns");
+
+    for (const char* name : PerfCounters::names)
+        fmt::print(file, ",{}", name);
+
+    fmt::print(file, "\n");
+
+    for (const Record& record : state.records)
+    {
+        const BenchmarkResult& r = record.result;
+
+        fmt::print(
+            file,
+            "{},{},{},{},{},{:.1f},{:.1f},{:.1f},{:.1f},{:.1f},{:.1f}",
+            metadata,
+            csv_string(record.stack),
+            csv_string(record.test),
+            record.size,
+            r.samples.size(),
+            r.median,
+            r.mad,
+            r.min,
+            r.p90,
+            r.p99,
+            r.max);
+
+        // Counts per run, empty if not counted
+        for (std::size_t j = 0; j < PerfCounters::num_events; ++j)
+        {
+            if (j < r.counters.size() && r.counters[j] >= 0)
+                fmt::print(file, ",{:.1f}", r.counters[j]);
+            else
+                fmt::print(file, ",");
+        }
+
+        fmt::print(file, "\n");
+    }
+
+    return std::fclose(file) == 0;
+}
+
+} // namespace dr
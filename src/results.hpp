@@ -0,0 +1,41 @@
+#pragma once
+
+#include <string>
+#include <vector>
+
+#include "benchmark.hpp"
+
+namespace dr
+{
+
+// Selects resource stacks and tests by name, and collects benchmark results so they can be
+// written in machine-readable form. Filters are comma-separated lists of shell globs (as in
+// fnmatch), e.g. "pool*,slab resource". Everything is selected by default.
+void set_stack_filter(const char* globs);
+void set_test_filter(const char* globs);
+
+// Runs tests once for each of the sizes, which the tests read with test_size. Each size gets fresh
+// resource stacks, so resources that never free (e.g. monotonic buffers) only hold one size's runs.
+void sweep_tests(void (*tests)(), const std::vector<int>& sizes);
+
+// Returns the size of the current sweep, or default_size outside of a sweep
+int test_size(int default_size);
+
+// Starts a resource stack, printing its heading. Returns false (and prints nothing) if the stack
+// isn't selected, in which case the caller should skip it.
+bool begin_stack(const char* name);
+
+// Returns the name of the stack started last
+const std::string& current_stack();
+
+bool test_selected(const char* name);
+
+// Records the result of a test run at the given size on the current stack
+void add_result(const char* test, int size, const BenchmarkResult& result);
+
+// Write the recorded results with host and build metadata. The JSON output includes every
+// sample. Return false if the file can't be written.
+bool write_json(const char* path, const char* program);
+bool write_csv(const char* path, const char* program);
+
+} // namespace dr
@@ -0,0 +1,125 @@
+#include "slab_memory_resource.hpp"
+
+#include <algorithm>
+
+namespace dr
+{
+namespace
+{
+
+constexpr std::size_t granularity = 8;
+
+// Maps (bytes - 1) / granularity to the smallest size class that holds it
+constexpr auto make_size_class_table()
+{
+    constexpr std::size_t n = SlabMemoryResource::max_block_size / granularity;
+    std::array<std::uint8_t, n> result{};
+    std::size_t index = 0;
+
+    for (std::size_t i = 0; i < n; ++i)
+    {
+        while (SlabMemoryResource::size_classes[index] < (i + 1) * granularity)
+            ++index;
+
+        result[i] = static_cast<std::uint8_t>(index);
+    }
+
+    return result;
+}
+
+constexpr auto size_class_table = make_size_class_table();
+
+} // namespace
+
+std::size_t SlabMemoryResource::find_size_class(std::size_t bytes, std::size_t alignment)
+{
+    if (bytes > max_block_size || alignment > slab_alignment)
+        return no_size_class;
+
+    // Blocks are aligned to the largest power of two that divides their size
+    std::size_t index = size_class_table[(std::max<std::size_t>(bytes, 1) - 1) / granularity];
+    while (index < num_size_classes && size_classes[index] % alignment != 0)
+        ++index;
+
+    return index;
+}
+
+void SlabMemoryResource::release()
+{
+    while (slabs != nullptr)
+    {
+        Slab* const next = slabs->next;
+        upstream->deallocate(slabs, slabs->size, slab_alignment);
+        slabs = next;
+    }
+
+    for (auto& c : classes)
+        c = {};
+}
+
+void* SlabMemoryResource::allocate_from_slab(std::size_t index)
+{
+    SizeClass& c = classes[index];
+    const std::size_t block_size = size_classes[index];
+
+    if (c.bump + block_size > c.bump_end)
+    {
+        // The first slab_alignment bytes of each slab hold its header
+        const std::size_t size = std::max(min_slab_size, slab_alignment + 16 * block_size);
+        auto* const slab = static_cast<Slab*>(upstream->allocate(size, slab_alignment));
+        *slab = {slabs, size};
+        slabs = slab;
+
+        c.bump = reinterpret_cast<std::byte*>(slab) + slab_alignment;
+        c.bump_end = reinterpret_cast<std::byte*>(slab) + size;
+    }
+
+    void* const result = c.bump;
+    c.bump += block_size;
+    return result;
+}
+
+void* SlabMemoryResource::do_allocate(std::size_t bytes, std::size_t alignment)
+{
+    const std::size_t index = find_size_class(bytes, alignment);
+
+    if (index == no_size_class)
+        return upstream->allocate(bytes, alignment);
+
+    SizeClass& c = classes[index];
+
+    if (c.free != nullptr)
+    {
+        Block* const block = c.free;
+        c.free = block->next;
+        return block;
+    }
+
+    return allocate_from_slab(index);
+}
+
+void SlabMemoryResource::do_deallocate(void* ptr, std::size_t bytes, std::size_t alignment)
+{
+    const std::size_t index = find_size_class(bytes, alignment);
+
+    if (index == no_size_class)
+    {
+        upstream->deallocate(ptr, bytes, alignment);
+        return;
+    }
+
+    SizeClass& c = classes[index];
+    auto* const block = static_cast<Block*>(ptr);
+    block->next = c.free;
+    c.free = block;
+}
+
+bool SlabMemoryResource::do_try_expand(void* /*ptr*/, std::size_t old_bytes, std::size_t new_bytes, std::size_t alignment)
+{
+    // Blocks go back to the free list of the class of the size they're freed with, so a block
+    // resized into another class would be returned to the wrong list and its tail lost for good
+    const std::size_t index = find_size_class(old_bytes, alignment);
+    return index != no_size_class && find_size_class(new_bytes, alignment) == index;
+}
+
+} // namespace dr
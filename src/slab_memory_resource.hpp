@@ -0,0 +1,84 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <memory_resource>
+
+#include "expandable_memory_resource.hpp"
+
+namespace dr
+{
+
+// Pool resource with fixed size classes. Each size class keeps an intrusive free list of blocks
+// and carves new blocks from slabs requested from upstream. Requests larger than the largest
+// size class (or with stricter alignment than slabs provide) go directly to upstream.
+//
+// Blocks can grow or shrink in place as long as the new size stays in the same class. Like
+// std::pmr::unsynchronized_pool_resource, this is not thread safe. Slabs are only returned to
+// upstream on release() or destruction.
+struct SlabMemoryResource : public ExpandableMemoryResource
+{
+    static constexpr std::size_t size_classes[] = {
+        8, 16, 32, 48, 64, 80, 96, 112, 128,
+        160, 192, 224, 256, 320, 384, 448, 512,
+        640, 768, 896, 1024, 1280, 1536, 1792, 2048,
+        2560, 3072, 3584, 4096};
+
+    static constexpr std::size_t num_size_classes = std::size(size_classes);
+    static constexpr std::size_t max_block_size = size_classes[num_size_classes - 1];
+    static constexpr std::size_t slab_alignment = 64;
+    static constexpr std::size_t min_slab_size = 64 * 1024;
+    static constexpr std::size_t no_size_class = num_size_classes;
+
+    struct Block
+    {
+        Block* next;
+    };
+
+    struct Slab
+    {
+        Slab* next;
+        std::size_t size;
+    };
+
+    struct SizeClass
+    {
+        Block* free{};
+        std::byte* bump{};
+        std::byte* bump_end{};
+    };
+
+    std::pmr::memory_resource* upstream;
+    SizeClass classes[num_size_classes]{};
+    Slab* slabs{};
+
+    SlabMemoryResource(std::pmr::memory_resource* upstream) :
+        upstream{upstream} {}
+
+    SlabMemoryResource(const SlabMemoryResource&) = delete;
+    SlabMemoryResource& operator=(const SlabMemoryResource&) = delete;
+
+    ~SlabMemoryResource() { release(); }
+
+    // Returns all slabs to upstream. Outstanding blocks become invalid.
+    void release();
+
+    // Returns the index of the smallest size class that can hold the given request, or
+    // no_size_class if the request must go to upstream
+    static std::size_t find_size_class(std::size_t bytes, std::size_t alignment);
+
+    void* do_allocate(std::size_t bytes, std::size_t alignment) override;
+    void do_deallocate(void* ptr, std::size_t bytes, std::size_t alignment) override;
+    bool do_try_expand(void* ptr, std::size_t old_bytes, std::size_t new_bytes, std::size_t alignment) override;
+
+    bool do_is_equal(const std::pmr::memory_resource& other) const noexcept override
+    {
+        return this == &other;
+    };
+
+  private:
+    void* allocate_from_slab(std::size_t index);
+};
+
+} // namespace dr
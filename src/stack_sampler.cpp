@@ -0,0 +1,183 @@
+#include "stack_sampler.hpp"
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstdint>
+#include <cstring>
+#include <map>
+#include <string>
+
+#include <cxxabi.h>
+#include <dlfcn.h>
+#include <execinfo.h>
+
+#include <fmt/core.h>
+
+namespace dr
+{
+namespace
+{
+
+struct
+{
+    StackSampler* sampler{};
+} state;
+
+// Frames for sample() and the resource calling record()
+constexpr int skipped_frames = 2;
+
+std::string demangle(const char* name)
+{
+    int status{};
+    char* const result = abi::__cxa_demangle(name, nullptr, nullptr, &status);
+
+    if (result == nullptr)
+        return name;
+
+    std::string demangled{result};
+    std::free(result);
+    return demangled;
+}
+
+// Frame that isn't in the dynamic symbol table, identified by module and offset
+struct Unresolved
+{
+    void* frame;
+    std::uintptr_t offset;
+};
+
+// Resolves frames with addr2line, leaving names empty where that fails
+void resolve_with_addr2line(
+    const std::string& module,
+    const std::vector<Unresolved>& frames,
+    std::map<void*, std::string>& names)
+{
+    std::string command = "addr2line -f -C -e '" + module + "'";
+
+    for (const Unresolved& f : frames)
+        command += fmt::format(" {:#x}", f.offset);
+
+    command += " 2>/dev/null";
+    std::FILE* const pipe = popen(command.c_str(), "r");
+
+    if (pipe == nullptr)
+        return;
+
+    // Output is two lines per address: the function name, then the source location
+    char line[4096];
+    for (const Unresolved& f : frames)
+    {
+        if (std::fgets(line, sizeof(line), pipe) == nullptr)
+            break;
+
+        std::string name{line};
+        while (!name.empty() && name.back() == '\n')
+            name.pop_back();
+
+        if (name != "??")
+            names[f.frame] = name;
+
+        if (std::fgets(line, sizeof(line), pipe) == nullptr)
+            break;
+    }
+
+    pclose(pipe);
+}
+
+std::map<void*, std::string> resolve(const std::unordered_map<std::vector<void*>, std::size_t, StackSampler::FramesHash>& stacks)
+{
+    std::map<void*, std::string> names{};
+    std::map<std::string, std::vector<Unresolved>> unresolved{};
+
+    for (const auto& [frames, count] : stacks)
+    {
+        for (void* const frame : frames)
+        {
+            if (names.count(frame) != 0)
+                continue;
+
+            Dl_info info{};
+            if (dladdr(frame, &info) == 0 || info.dli_fname == nullptr)
+            {
+                names[frame] = fmt::format("{}", frame);
+                continue;
+            }
+
+            if (info.dli_sname != nullptr)
+            {
+                names[frame] = demangle(info.dli_sname);
+                continue;
+            }
+
+            // Name by module and offset unless addr2line does better. Return addresses point past
+            // the call so step back into it.
+            const auto offset = reinterpret_cast<std::uintptr_t>(frame) - reinterpret_cast<std::uintptr_t>(info.dli_fbase);
+            const char* const module = std::strrchr(info.dli_fname, '/');
+            names[frame] = fmt::format("{}+{:#x}", module != nullptr ? module + 1 : info.dli_fname, offset);
+            unresolved[info.dli_fname].push_back({frame, offset - 1});
+        }
+    }
+
+    for (const auto& [module, frames] : unresolved)
+        resolve_with_addr2line(module, frames, names);
+
+    return names;
+}
+
+} // namespace
+
+std::size_t StackSampler::FramesHash::operator()(const std::vector<void*>& frames) const
+{
+    std::size_t result = frames.size();
+
+    for (void* const frame : frames)
+        result = result * 31 + std::hash<void*>{}(frame);
+
+    return result;
+}
+
+void StackSampler::sample(std::size_t n)
+{
+    // n covers every interval boundary between here and the next countdown
+    const std::size_t over = n - countdown;
+    const std::size_t intervals = 1 + over / interval;
+    countdown = interval - over % interval;
+
+    void* frames[max_depth + skipped_frames];
+    const int depth = backtrace(frames, max_depth + skipped_frames);
+
+    if (depth <= skipped_frames)
+        return;
+
+    stacks[std::vector<void*>(frames + skipped_frames, frames + depth)] += intervals;
+}
+
+bool StackSampler::write_folded(const char* path) const
+{
+    std::FILE* const file = std::fopen(path, "w");
+
+    if (file == nullptr)
+        return false;
+
+    const std::map<void*, std::string> names = resolve(stacks);
+
+    for (const auto& [frames, count] : stacks)
+    {
+        std::string line{};
+
+        for (auto it = frames.rbegin(); it != frames.rend(); ++it)
+        {
+            if (!line.empty()) line += ';';
+            line += names.at(*it);
+        }
+
+        fmt::print(file, "{} {}\n", line, count * interval);
+    }
+
+    return std::fclose(file) == 0;
+}
+
+StackSampler* get_stack_sampler() { return state.sampler; }
+void set_stack_sampler(StackSampler* sampler) { state.sampler = sampler; }
+
+} // namespace dr
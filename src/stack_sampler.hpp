@@ -0,0 +1,65 @@
+#pragma once
+
+#include <cstddef>
+#include <unordered_map>
+#include <vector>
+
+namespace dr
+{
+
+// Records a backtrace every interval allocations (or bytes) and aggregates samples per unique
+// call stack. Stacks are written in the folded format read by flamegraph tools, e.g.
+//
+//   flamegraph.pl stacks.folded > stacks.svg
+//
+// Frames are named via the dynamic symbol table where possible. Functions with internal linkage
+// aren't in that table so they're resolved with addr2line, if available.
+struct StackSampler
+{
+    enum class Unit
+    {
+        allocations,
+        bytes,
+    };
+
+    static constexpr int max_depth = 64;
+
+    struct FramesHash
+    {
+        std::size_t operator()(const std::vector<void*>& frames) const;
+    };
+
+    Unit unit;
+    std::size_t interval;
+    std::size_t countdown;
+
+    // Number of intervals attributed to each stack, leaf first
+    std::unordered_map<std::vector<void*>, std::size_t, FramesHash> stacks{};
+
+    StackSampler(Unit unit, std::size_t interval) :
+        unit{unit}, interval{interval}, countdown{interval} {}
+
+    // Called by a resource on each allocation. Frames of the caller (i.e. the resource) are
+    // excluded from the recorded stack.
+    void record(std::size_t bytes)
+    {
+        const std::size_t n = unit == Unit::bytes ? bytes : 1;
+
+        if (n < countdown)
+            countdown -= n;
+        else
+            sample(n);
+    }
+
+    // Writes one line per stack (root first) weighted by the estimated number of allocations or
+    // bytes. Returns false if the file can't be written.
+    bool write_folded(const char* path) const;
+
+  private:
+    void sample(std::size_t n);
+};
+
+StackSampler* get_stack_sampler();
+void set_stack_sampler(StackSampler* sampler);
+
+} // namespace dr
@@ -0,0 +1,139 @@
+#include "stats_segment.hpp"
+
+#include <cstring>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+#include <fmt/format.h>
+
+namespace dr
+{
+namespace
+{
+
+struct
+{
+    StatsPublisher* publisher{};
+} state;
+
+} // namespace
+
+void StatsSlot::set_name(const char* new_name)
+{
+    begin_write();
+    std::memset(name, 0, sizeof(name));
+    std::strncpy(name, new_name, sizeof(name) - 1);
+    end_write();
+}
+
+std::string stats_segment_name(long pid)
+{
+    return fmt::format("/pmr-stats.{}", pid);
+}
+
+StatsPublisher::StatsPublisher()
+{
+    const std::string name = stats_segment_name(getpid());
+
+    const int fd = shm_open(name.c_str(), O_CREAT | O_RDWR | O_TRUNC, 0644);
+
+    if (fd < 0)
+        return;
+
+    if (ftruncate(fd, sizeof(StatsSegment)) != 0)
+    {
+        close(fd);
+        shm_unlink(name.c_str());
+        return;
+    }
+
+    void* const ptr = mmap(nullptr, sizeof(StatsSegment), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+
+    if (ptr == MAP_FAILED)
+    {
+        shm_unlink(name.c_str());
+        return;
+    }
+
+    // The mapping is zero-filled, so only the header needs writing. Readers check it last.
+    segment = static_cast<StatsSegment*>(ptr);
+    segment->segment_version = StatsSegment::version;
+    segment->pid = static_cast<std::uint32_t>(getpid());
+    std::atomic_thread_fence(std::memory_order_release);
+    std::memcpy(segment->header, StatsSegment::magic, sizeof(segment->header));
+}
+
+StatsPublisher::~StatsPublisher()
+{
+    if (segment == nullptr)
+        return;
+
+    const std::string name = stats_segment_name(getpid());
+
+    munmap(segment, sizeof(StatsSegment));
+    shm_unlink(name.c_str());
+}
+
+StatsSlot* StatsPublisher::acquire()
+{
+    if (segment == nullptr)
+        return nullptr;
+
+    const std::lock_guard<std::mutex> lock{mutex};
+
+    for (StatsSlot& slot : segment->slots)
+    {
+        if (slot.used.load(std::memory_order_relaxed) != 0)
+            continue;
+
+        slot.begin_write();
+        slot.id.store(next_id++, std::memory_order_relaxed);
+        slot.num_allocs.store(0, std::memory_order_relaxed);
+        slot.num_deallocs.store(0, std::memory_order_relaxed);
+        slot.curr_bytes.store(0, std::memory_order_relaxed);
+        slot.max_bytes.store(0, std::memory_order_relaxed);
+
+        for (auto& count : slot.size_counts)
+            count.store(0, std::memory_order_relaxed);
+
+        std::memset(slot.name, 0, sizeof(slot.name));
+
+        slot.end_write();
+        slot.used.store(1, std::memory_order_release);
+        return &slot;
+    }
+
+    return nullptr;
+}
+
+void StatsPublisher::release(StatsSlot* slot)
+{
+    slot->used.store(0, std::memory_order_release);
+}
+
+void StatsPublisher::set_label(const char* label)
+{
+    if (segment == nullptr)
+        return;
+
+    const std::lock_guard<std::mutex> lock{mutex};
+
+    // Readers copy the label under label_seq, so a torn copy is retried rather than shown
+    segment->label_seq.store(segment->label_seq.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+
+    std::memset(segment->label, 0, sizeof(segment->label));
+
+    if (label != nullptr)
+        std::strncpy(segment->label, label, sizeof(segment->label) - 1);
+
+    segment->label_seq.store(segment->label_seq.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+}
+
+StatsPublisher* get_stats_publisher() { return state.publisher; }
+void set_stats_publisher(StatsPublisher* publisher) { state.publisher = publisher; }
+
+} // namespace dr
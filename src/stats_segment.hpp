@@ -0,0 +1,101 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <string>
+
+namespace dr
+{
+
+// Counters of one resource, written by a single thread and read by other processes. Writers bump
+// seq to an odd value, update the counters and bump it back to even, so a reader that sees the
+// same even seq before and after copying has a consistent snapshot.
+struct StatsSlot
+{
+    static constexpr std::size_t num_buckets = 64;
+    static constexpr std::size_t name_size = 96;
+
+    std::atomic<std::uint32_t> seq{};
+    std::atomic<std::uint32_t> used{};
+    std::atomic<std::uint64_t> id{};
+    std::atomic<std::uint64_t> num_allocs{};
+    std::atomic<std::uint64_t> num_deallocs{};
+    std::atomic<std::uint64_t> curr_bytes{};
+    std::atomic<std::uint64_t> max_bytes{};
+
+    // Bucket i counts requests of size (2^(i-1), 2^i] as in DebugMemoryResource
+    std::atomic<std::uint64_t> size_counts[num_buckets]{};
+
+    // Name of the resource, e.g. "<stack> / requested". Empty until set_name is called.
+    char name[name_size]{};
+
+    void begin_write()
+    {
+        seq.store(seq.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+    }
+
+    void end_write()
+    {
+        seq.store(seq.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+    }
+
+    // Called by the writer, truncating names that don't fit
+    void set_name(const char* new_name);
+};
+
+// Layout of the shared memory segment at /dev/shm/pmr-stats.<pid>
+struct StatsSegment
+{
+    static constexpr char magic[8] = "pmrstat";
+    static constexpr std::uint32_t version = 2;
+    static constexpr std::size_t max_slots = 64;
+    static constexpr std::size_t label_size = 64;
+
+    char header[8];
+    std::uint32_t segment_version;
+    std::uint32_t pid;
+
+    // Label of the running test, guarded by label_seq like a slot
+    std::atomic<std::uint32_t> label_seq{};
+    char label[label_size]{};
+
+    StatsSlot slots[max_slots]{};
+};
+
+static_assert(std::atomic<std::uint64_t>::is_always_lock_free, "stats must be lock free to share between processes");
+
+// Returns the name of the segment published by the given process, as passed to shm_open
+std::string stats_segment_name(long pid);
+
+// Creates the stats segment of this process and hands out its slots. The segment is removed on
+// destruction. Reading it never blocks writers.
+struct StatsPublisher
+{
+    StatsSegment* segment{};
+    std::uint64_t next_id{};
+    std::mutex mutex{};
+
+    StatsPublisher();
+
+    StatsPublisher(const StatsPublisher&) = delete;
+    StatsPublisher& operator=(const StatsPublisher&) = delete;
+
+    ~StatsPublisher();
+
+    // Returns false if the segment couldn't be created
+    bool valid() const { return segment != nullptr; }
+
+    // Returns a zeroed slot, or null if all slots are in use
+    StatsSlot* acquire();
+    void release(StatsSlot* slot);
+
+    void set_label(const char* label);
+};
+
+StatsPublisher* get_stats_publisher();
+void set_stats_publisher(StatsPublisher* publisher);
+
+} // namespace dr
@@ -0,0 +1,180 @@
+#include "thread_caching_memory_resource.hpp"
+
+#include <algorithm>
+
+namespace dr
+{
+namespace
+{
+
+using Cache = ThreadCachingMemoryResource::Cache;
+using Header = ThreadCachingMemoryResource::Header;
+using RemoteBlock = ThreadCachingMemoryResource::RemoteBlock;
+using ThreadState = ThreadCachingMemoryResource::ThreadState;
+
+std::atomic<std::uint64_t> next_id{1};
+
+// Remembers the last cache used by this thread. Resources are identified by id rather than
+// address so a new resource at the address of a destroyed one doesn't pick up a stale cache.
+thread_local struct
+{
+    std::uint64_t id{};
+    Cache* cache{};
+} last_cache;
+
+// Marks the thread as exited when it ends, so its caches can be adopted
+struct ThreadHandle
+{
+    std::shared_ptr<ThreadState> state{std::make_shared<ThreadState>()};
+
+    ThreadHandle() = default;
+
+    ThreadHandle(const ThreadHandle&) = delete;
+    ThreadHandle& operator=(const ThreadHandle&) = delete;
+
+    ~ThreadHandle()
+    {
+        state->exited.store(true, std::memory_order_release);
+    }
+};
+
+thread_local ThreadHandle this_thread;
+
+// Layout of a block within the pool allocation backing it
+struct Layout
+{
+    std::size_t offset;
+    std::size_t size;
+    std::size_t alignment;
+
+    Layout(std::size_t bytes, std::size_t alignment) :
+        alignment{std::max(alignment, alignof(Header))}
+    {
+        offset = (sizeof(Header) + this->alignment - 1) & ~(this->alignment - 1);
+        size = std::max(offset + bytes, sizeof(RemoteBlock));
+    }
+};
+
+Header* header_of(void* ptr)
+{
+    return reinterpret_cast<Header*>(static_cast<std::byte*>(ptr) - sizeof(Header));
+}
+
+void drain_remote_free(Cache* cache)
+{
+    RemoteBlock* block = cache->remote_free.exchange(nullptr, std::memory_order_acquire);
+
+    while (block != nullptr)
+    {
+        RemoteBlock* const next = block->next;
+        cache->pool.deallocate(block, block->size, block->alignment);
+        block = next;
+    }
+}
+
+} // namespace
+
+ThreadCachingMemoryResource::ThreadCachingMemoryResource(std::pmr::memory_resource* upstream) :
+    upstream{upstream}, id{next_id.fetch_add(1, std::memory_order_relaxed)}
+{
+}
+
+ThreadCachingMemoryResource::~ThreadCachingMemoryResource()
+{
+    for (const auto& cache : caches)
+        drain_remote_free(cache.get());
+}
+
+Cache* ThreadCachingMemoryResource::local_cache()
+{
+    if (last_cache.id == id)
+        return last_cache.cache;
+
+    const std::shared_ptr<ThreadState>& thread = this_thread.state;
+    Cache* cache = nullptr;
+
+    {
+        std::lock_guard<std::mutex> lock{mutex};
+
+        for (auto& c : caches)
+        {
+            if (c->thread == thread)
+            {
+                cache = c.get();
+                break;
+            }
+        }
+
+        // Caches of exited threads are only touched under the mutex, so their remote frees can be
+        // drained here. The first one is adopted rather than creating another cache.
+        for (auto& c : caches)
+        {
+            if (c.get() == cache || !c->thread->exited.load(std::memory_order_acquire))
+                continue;
+
+            drain_remote_free(c.get());
+
+            if (cache == nullptr)
+            {
+                c->thread = thread;
+                c->current_thread.store(thread.get(), std::memory_order_relaxed);
+                cache = c.get();
+            }
+        }
+
+        if (cache == nullptr)
+        {
+            caches.push_back(std::make_unique<Cache>(thread, upstream));
+            cache = caches.back().get();
+        }
+    }
+
+    last_cache = {id, cache};
+    return cache;
+}
+
+void* ThreadCachingMemoryResource::do_allocate(std::size_t bytes, std::size_t alignment)
+{
+    Cache* const cache = local_cache();
+
+    if (cache->remote_free.load(std::memory_order_relaxed) != nullptr)
+        drain_remote_free(cache);
+
+    const Layout layout{bytes, alignment};
+    auto* const base = static_cast<std::byte*>(cache->pool.allocate(layout.size, layout.alignment));
+    void* const result = base + layout.offset;
+    header_of(result)->owner = cache;
+
+    return result;
+}
+
+void ThreadCachingMemoryResource::do_deallocate(void* ptr, std::size_t bytes, std::size_t alignment)
+{
+    Cache* const owner = header_of(ptr)->owner;
+    const Layout layout{bytes, alignment};
+    std::byte* const base = static_cast<std::byte*>(ptr) - layout.offset;
+
+    // Comparing owners rather than calling local_cache keeps threads that only free from
+    // creating caches. Only the owner itself can see its own state here.
+    if (owner->current_thread.load(std::memory_order_relaxed) == this_thread.state.get())
+    {
+        owner->pool.deallocate(base, layout.size, layout.alignment);
+        return;
+    }
+
+    // Freed by another thread so hand it back to the owner
+    auto* const block = reinterpret_cast<RemoteBlock*>(base);
+    block->size = layout.size;
+    block->alignment = layout.alignment;
+    block->next = owner->remote_free.load(std::memory_order_relaxed);
+
+    while (!owner->remote_free.compare_exchange_weak(
+        block->next,
+        block,
+        std::memory_order_release,
+        std::memory_order_relaxed))
+    {
+    }
+}
+
+} // namespace dr
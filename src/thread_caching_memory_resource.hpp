@@ -0,0 +1,89 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <memory_resource>
+#include <mutex>
+#include <utility>
+#include <vector>
+
+#include "slab_memory_resource.hpp"
+
+namespace dr
+{
+
+// Thread-safe pool resource in the style of tcmalloc. Each thread allocates from its own
+// unsynchronized slab pool. Blocks freed by their owning thread go straight back to its pool.
+// Blocks freed by other threads are pushed onto the owner's lock-free remote free list, which
+// the owner drains in one batch on its next allocation.
+//
+// Each block is prefixed with a pointer to its owning cache. Upstream must be thread safe. A
+// cache outlives its thread: the next thread to need a cache adopts it along with the blocks
+// freed to it since, and caches are released with the resource, so the resource must outlive
+// all blocks allocated from it.
+struct ThreadCachingMemoryResource : public std::pmr::memory_resource
+{
+    struct RemoteBlock
+    {
+        RemoteBlock* next;
+        std::size_t size;
+        std::size_t alignment;
+    };
+
+    // Identifies a thread for as long as a cache refers to it. Unlike std::thread::id, it isn't
+    // reused by a later thread while it's referenced.
+    struct ThreadState
+    {
+        std::atomic<bool> exited{};
+    };
+
+    struct Cache
+    {
+        // Owning thread, changed under the resource mutex when the cache is adopted
+        std::shared_ptr<ThreadState> thread;
+
+        // Same as thread, for the deallocate path to check ownership without the mutex
+        std::atomic<const ThreadState*> current_thread;
+
+        SlabMemoryResource pool;
+        std::atomic<RemoteBlock*> remote_free{};
+
+        Cache(std::shared_ptr<ThreadState> thread, std::pmr::memory_resource* upstream) :
+            thread{std::move(thread)}, current_thread{this->thread.get()}, pool{upstream} {}
+    };
+
+    struct Header
+    {
+        Cache* owner;
+    };
+
+    std::pmr::memory_resource* upstream;
+    std::uint64_t id;
+    std::mutex mutex{};
+    std::vector<std::unique_ptr<Cache>> caches{};
+
+    ThreadCachingMemoryResource(std::pmr::memory_resource* upstream);
+
+    ThreadCachingMemoryResource(const ThreadCachingMemoryResource&) = delete;
+    ThreadCachingMemoryResource& operator=(const ThreadCachingMemoryResource&) = delete;
+
+    // Returns blocks still on remote free lists to their pools, so those the pools forwarded
+    // upstream (large or over-aligned) are freed before the pools are destroyed
+    ~ThreadCachingMemoryResource();
+
+    // Returns the calling thread's cache. On first use, the thread adopts the cache of a thread
+    // that has exited if there is one, or creates a new cache otherwise.
+    Cache* local_cache();
+
+    void* do_allocate(std::size_t bytes, std::size_t alignment) override;
+    void do_deallocate(void* ptr, std::size_t bytes, std::size_t alignment) override;
+
+    bool do_is_equal(const std::pmr::memory_resource& other) const noexcept override
+    {
+        return this == &other;
+    };
+};
+
+} // namespace dr
@@ -0,0 +1,253 @@
+#include "tlsf_memory_resource.hpp"
+
+#include <algorithm>
+#include <new>
+
+namespace dr
+{
+namespace
+{
+
+using Block = TlsfMemoryResource::Block;
+using FreeLinks = TlsfMemoryResource::FreeLinks;
+
+constexpr std::size_t header_size = sizeof(Block);
+constexpr std::size_t min_block_size = sizeof(FreeLinks);
+constexpr std::size_t free_bit = 1;
+constexpr std::size_t prev_free_bit = 2;
+constexpr std::size_t flag_bits = free_bit | prev_free_bit;
+
+static_assert(header_size % TlsfMemoryResource::align_size == 0);
+static_assert(TlsfMemoryResource::fl_index_count <= 32);
+
+constexpr std::size_t align_up(std::size_t value, std::size_t alignment)
+{
+    return (value + alignment - 1) & ~(alignment - 1);
+}
+
+// Index of the most significant set bit
+int fls(std::size_t value) { return 63 - __builtin_clzll(value); }
+
+// Index of the least significant set bit
+int ffs(std::uint32_t value) { return __builtin_ctz(value); }
+
+std::size_t block_size(const Block* block) { return block->size & ~flag_bits; }
+bool is_free(const Block* block) { return block->size & free_bit; }
+bool is_prev_free(const Block* block) { return block->size & prev_free_bit; }
+
+std::byte* payload(Block* block) { return reinterpret_cast<std::byte*>(block) + header_size; }
+Block* from_payload(void* ptr) { return reinterpret_cast<Block*>(static_cast<std::byte*>(ptr) - header_size); }
+Block* next_phys(Block* block) { return reinterpret_cast<Block*>(payload(block) + block_size(block)); }
+FreeLinks* links(Block* block) { return reinterpret_cast<FreeLinks*>(payload(block)); }
+
+void set_size(Block* block, std::size_t size) { block->size = size | (block->size & flag_bits); }
+
+void mark_free(Block* block)
+{
+    block->size |= free_bit;
+    Block* const next = next_phys(block);
+    next->prev_phys = block;
+    next->size |= prev_free_bit;
+}
+
+void mark_used(Block* block)
+{
+    block->size &= ~free_bit;
+    next_phys(block)->size &= ~prev_free_bit;
+}
+
+// Returns the bin holding blocks of the given size
+void mapping_insert(std::size_t size, int& fl, int& sl)
+{
+    if (size < TlsfMemoryResource::small_block_size)
+    {
+        fl = 0;
+        sl = int(size / (TlsfMemoryResource::small_block_size / TlsfMemoryResource::sl_index_count));
+    }
+    else
+    {
+        fl = fls(size);
+        sl = int(size >> (fl - TlsfMemoryResource::sl_index_log2)) ^ TlsfMemoryResource::sl_index_count;
+        fl -= TlsfMemoryResource::fl_index_shift - 1;
+    }
+}
+
+// Returns the first bin whose blocks are all at least the given size
+void mapping_search(std::size_t size, int& fl, int& sl)
+{
+    if (size >= TlsfMemoryResource::small_block_size)
+        size += (std::size_t{1} << (fls(size) - TlsfMemoryResource::sl_index_log2)) - 1;
+
+    mapping_insert(size, fl, sl);
+}
+
+} // namespace
+
+TlsfMemoryResource::TlsfMemoryResource(std::size_t capacity, std::pmr::memory_resource* upstream) :
+    upstream{upstream}, capacity{align_up(capacity, align_size)}
+{
+    // One free block spanning the region followed by a zero-sized sentinel that is never free
+    const std::size_t min_capacity = 2 * header_size + min_block_size;
+    if (this->capacity < min_capacity) this->capacity = min_capacity;
+
+    region = static_cast<std::byte*>(upstream->allocate(this->capacity, align_size));
+
+    Block* const block = reinterpret_cast<Block*>(region);
+    block->prev_phys = nullptr;
+    block->size = this->capacity - 2 * header_size;
+
+    Block* const sentinel = next_phys(block);
+    sentinel->size = 0;
+
+    mark_free(block);
+    insert_free(block);
+}
+
+TlsfMemoryResource::~TlsfMemoryResource()
+{
+    upstream->deallocate(region, capacity, align_size);
+}
+
+void TlsfMemoryResource::insert_free(Block* block)
+{
+    int fl, sl;
+    mapping_insert(block_size(block), fl, sl);
+
+    Block*& head = free_lists[fl][sl];
+    *links(block) = {head, nullptr};
+    if (head != nullptr) links(head)->prev = block;
+    head = block;
+
+    fl_bitmap |= std::uint32_t{1} << fl;
+    sl_bitmap[fl] |= std::uint32_t{1} << sl;
+}
+
+void TlsfMemoryResource::remove_free(Block* block)
+{
+    int fl, sl;
+    mapping_insert(block_size(block), fl, sl);
+
+    FreeLinks* const l = links(block);
+    if (l->next != nullptr) links(l->next)->prev = l->prev;
+
+    if (l->prev != nullptr)
+    {
+        links(l->prev)->next = l->next;
+    }
+    else
+    {
+        free_lists[fl][sl] = l->next;
+
+        if (l->next == nullptr)
+        {
+            sl_bitmap[fl] &= ~(std::uint32_t{1} << sl);
+            if (sl_bitmap[fl] == 0) fl_bitmap &= ~(std::uint32_t{1} << fl);
+        }
+    }
+}
+
+TlsfMemoryResource::Block* TlsfMemoryResource::find_free(std::size_t size)
+{
+    int fl, sl;
+    mapping_search(size, fl, sl);
+
+    if (fl >= fl_index_count)
+        return nullptr;
+
+    std::uint32_t sl_map = sl_bitmap[fl] & (~std::uint32_t{0} << sl);
+
+    if (sl_map == 0)
+    {
+        // No suitable block in this first level so take the smallest from the next one up
+        const std::uint32_t fl_map = fl + 1 < 32 ? fl_bitmap & (~std::uint32_t{0} << (fl + 1)) : 0;
+        if (fl_map == 0) return nullptr;
+
+        fl = ffs(fl_map);
+        sl_map = sl_bitmap[fl];
+    }
+
+    Block* const block = free_lists[fl][ffs(sl_map)];
+    remove_free(block);
+    return block;
+}
+
+void* TlsfMemoryResource::do_allocate(std::size_t bytes, std::size_t alignment)
+{
+    const std::size_t size = std::max(align_up(bytes, align_size), min_block_size);
+
+    // Over-aligned requests need room to split off a leading free block
+    const std::size_t gap = alignment > align_size ? alignment + header_size + min_block_size : 0;
+
+    Block* block = find_free(size + gap);
+    if (block == nullptr)
+        return upstream->allocate(bytes, alignment);
+
+    if (gap != 0)
+    {
+        const auto addr = reinterpret_cast<std::uintptr_t>(payload(block));
+        std::uintptr_t aligned = align_up(addr, alignment);
+
+        if (aligned != addr)
+        {
+            if (aligned - addr < header_size + min_block_size)
+                aligned = align_up(addr + header_size + min_block_size, alignment);
+
+            // Give the leading gap back as a free block
+            const std::size_t lead = aligned - addr;
+            Block* const next = reinterpret_cast<Block*>(aligned - header_size);
+            next->size = block_size(block) - lead;
+            set_size(block, lead - header_size);
+            mark_free(block);
+            insert_free(block);
+            block = next;
+        }
+    }
+
+    // Split off the remainder if it's large enough to be a block
+    const std::size_t remain = block_size(block) - size;
+
+    if (remain >= header_size + min_block_size)
+    {
+        set_size(block, size);
+        Block* const rest = next_phys(block);
+        rest->size = remain - header_size;
+        mark_free(rest);
+        insert_free(rest);
+    }
+
+    mark_used(block);
+    return payload(block);
+}
+
+void TlsfMemoryResource::do_deallocate(void* ptr, std::size_t bytes, std::size_t alignment)
+{
+    if (!owns(ptr))
+    {
+        upstream->deallocate(ptr, bytes, alignment);
+        return;
+    }
+
+    Block* block = from_payload(ptr);
+
+    // Coalesce with free neighbours
+    if (is_prev_free(block))
+    {
+        Block* const prev = block->prev_phys;
+        remove_free(prev);
+        set_size(prev, block_size(prev) + header_size + block_size(block));
+        block = prev;
+    }
+
+    Block* const next = next_phys(block);
+
+    if (is_free(next))
+    {
+        remove_free(next);
+        set_size(block, block_size(block) + header_size + block_size(next));
+    }
+
+    mark_free(block);
+    insert_free(block);
+}
+
+} // namespace dr
@@ -0,0 +1,73 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory_resource>
+
+namespace dr
+{
+
+// Two-Level Segregated Fit allocator over a fixed region. Free blocks are binned by a first
+// level (power of two) and a second level (linear subdivision), and bitmaps over the bins make
+// finding a suitable block O(1). Freed blocks are coalesced with free neighbours immediately,
+// so allocation and deallocation are both O(1) regardless of size.
+//
+// The region is requested from upstream once on construction. Requests that don't fit in the
+// region fall back to upstream, which has no latency bound.
+struct TlsfMemoryResource : public std::pmr::memory_resource
+{
+    static constexpr std::size_t align_size = 16;
+    static constexpr int sl_index_log2 = 5;
+    static constexpr int sl_index_count = 1 << sl_index_log2;
+    static constexpr int fl_index_shift = sl_index_log2 + 4; // log2(align_size)
+    static constexpr int fl_index_max = 40;
+    static constexpr int fl_index_count = fl_index_max - fl_index_shift + 1;
+    static constexpr std::size_t small_block_size = std::size_t{1} << fl_index_shift;
+
+    // Header preceding each block's payload. The low bits of size hold flags.
+    struct Block
+    {
+        Block* prev_phys;
+        std::size_t size;
+    };
+
+    // Links stored in the payload of free blocks
+    struct FreeLinks
+    {
+        Block* next;
+        Block* prev;
+    };
+
+    std::pmr::memory_resource* upstream;
+    std::byte* region{};
+    std::size_t capacity{};
+    std::uint32_t fl_bitmap{};
+    std::uint32_t sl_bitmap[fl_index_count]{};
+    Block* free_lists[fl_index_count][sl_index_count]{};
+
+    TlsfMemoryResource(
+        std::size_t capacity,
+        std::pmr::memory_resource* upstream = std::pmr::new_delete_resource());
+
+    TlsfMemoryResource(const TlsfMemoryResource&) = delete;
+    TlsfMemoryResource& operator=(const TlsfMemoryResource&) = delete;
+
+    ~TlsfMemoryResource();
+
+    bool owns(const void* ptr) const { return ptr >= region && ptr < region + capacity; }
+
+    void* do_allocate(std::size_t bytes, std::size_t alignment) override;
+    void do_deallocate(void* ptr, std::size_t bytes, std::size_t alignment) override;
+
+    bool do_is_equal(const std::pmr::memory_resource& other) const noexcept override
+    {
+        return this == &other;
+    };
+
+  private:
+    void insert_free(Block* block);
+    void remove_free(Block* block);
+    Block* find_free(std::size_t size);
+};
+
+} // namespace dr
@@ -0,0 +1,181 @@
+#include "tracing_memory_resource.hpp"
+
+#include <cstdio>
+#include <string>
+
+#include <fmt/core.h>
+
+#include "stats_segment.hpp"
+
+namespace dr
+{
+namespace
+{
+
+struct
+{
+    Tracer* tracer{};
+    std::atomic<std::uint32_t> next_thread{};
+} state;
+
+std::uint32_t thread_index()
+{
+    thread_local const std::uint32_t index = state.next_thread.fetch_add(1, std::memory_order_relaxed);
+    return index;
+}
+
+std::size_t round_up_pow2(std::size_t n)
+{
+    std::size_t result = 1;
+    while (result < n) result <<= 1;
+    return result;
+}
+
+std::string escape(const char* str)
+{
+    std::string result{};
+
+    for (; *str != '\0'; ++str)
+    {
+        if (*str == '"' || *str == '\\') result += '\\';
+        result += *str;
+    }
+
+    return result;
+}
+
+} // namespace
+
+Tracer::Tracer(std::size_t capacity) :
+    capacity{round_up_pow2(capacity)},
+    slots{new Slot[this->capacity]}
+{
+}
+
+void Tracer::record(Kind kind, const void* ptr, std::size_t bytes, std::ptrdiff_t curr_bytes)
+{
+    const auto time = std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - start);
+    const std::uint64_t index = head.fetch_add(1, std::memory_order_relaxed);
+
+    Slot& slot = slots[index & (capacity - 1)];
+    slot.event = {
+        static_cast<std::uint64_t>(time.count()),
+        ptr,
+        bytes,
+        curr_bytes,
+        label.load(std::memory_order_relaxed),
+        thread_index(),
+        kind};
+
+    slot.seq.store(index + 1, std::memory_order_release);
+}
+
+void Tracer::set_label(const char* new_label)
+{
+    label.store(new_label, std::memory_order_relaxed);
+    record(Kind::label, nullptr, 0, 0);
+}
+
+bool Tracer::write_chrome_trace(const char* path) const
+{
+    std::FILE* const file = std::fopen(path, "w");
+
+    if (file == nullptr)
+        return false;
+
+    const std::uint64_t end = head.load(std::memory_order_acquire);
+    const std::uint64_t begin = end > capacity ? end - capacity : 0;
+
+    fmt::print(file, "{{\"traceEvents\":[\n");
+    fmt::print(file, "{{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":0,\"args\":{{\"name\":\"pmr\"}}}}");
+
+    // Label of the open slice. Slices are also opened from the labels of events, in case the
+    // event that started a slice has been overwritten.
+    const char* open_label = nullptr;
+
+    auto set_slice = [&](const char* label, double ts, std::uint32_t thread) {
+        if (open_label != nullptr)
+            fmt::print(file, ",\n{{\"ph\":\"E\",\"ts\":{:.3f},\"pid\":0,\"tid\":{}}}", ts, thread);
+
+        if (label != nullptr)
+            fmt::print(file, ",\n{{\"name\":\"{}\",\"ph\":\"B\",\"ts\":{:.3f},\"pid\":0,\"tid\":{}}}", escape(label), ts, thread);
+
+        open_label = label;
+    };
+
+    for (std::uint64_t i = begin; i < end; ++i)
+    {
+        const Slot& slot = slots[i & (capacity - 1)];
+
+        // Skip slots that were never written
+        if (slot.seq.load(std::memory_order_acquire) != i + 1)
+            continue;
+
+        const Event& e = slot.event;
+        const double ts = e.time_ns / 1000.0;
+
+        if (e.kind == Kind::label || e.label != open_label)
+            set_slice(e.label, ts, e.thread);
+
+        if (e.kind == Kind::label)
+            continue;
+
+        fmt::print(
+            file,
+            ",\n{{\"name\":\"{}\",\"ph\":\"i\",\"s\":\"t\",\"ts\":{:.3f},\"pid\":0,\"tid\":{},"
+            "\"args\":{{\"bytes\":{},\"ptr\":\"{}\",\"label\":\"{}\"}}}}",
+            e.kind == Kind::allocate ? "allocate" : "deallocate",
+            ts,
+            e.thread,
+            e.bytes,
+            e.ptr,
+            e.label != nullptr ? escape(e.label) : "");
+
+        fmt::print(
+            file,
+            ",\n{{\"name\":\"bytes in use\",\"ph\":\"C\",\"ts\":{:.3f},\"pid\":0,\"args\":{{\"bytes\":{}}}}}",
+            ts,
+            e.curr_bytes);
+    }
+
+    fmt::print(file, "\n],\"displayTimeUnit\":\"ns\"}}\n");
+    return std::fclose(file) == 0;
+}
+
+Tracer* get_tracer() { return state.tracer; }
+void set_tracer(Tracer* tracer) { state.tracer = tracer; }
+
+void set_trace_label(const char* label)
+{
+    if (state.tracer != nullptr)
+        state.tracer->set_label(label);
+
+    if (StatsPublisher* const publisher = get_stats_publisher(); publisher != nullptr)
+        publisher->set_label(label);
+}
+
+void* TracingMemoryResource::do_allocate(std::size_t bytes, std::size_t alignment)
+{
+    void* const ptr = upstream->allocate(bytes, alignment);
+
+    if (tracer != nullptr)
+    {
+        const std::ptrdiff_t curr = curr_bytes.fetch_add(bytes, std::memory_order_relaxed) + bytes;
+        tracer->record(Tracer::Kind::allocate, ptr, bytes, curr);
+    }
+
+    return ptr;
+}
+
+void TracingMemoryResource::do_deallocate(void* ptr, std::size_t bytes, std::size_t alignment)
+{
+    if (tracer != nullptr)
+    {
+        const std::ptrdiff_t curr = curr_bytes.fetch_sub(bytes, std::memory_order_relaxed) - bytes;
+        tracer->record(Tracer::Kind::deallocate, ptr, bytes, curr);
+    }
+
+    upstream->deallocate(ptr, bytes, alignment);
+}
+
+} // namespace dr
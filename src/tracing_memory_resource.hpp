@@ -0,0 +1,106 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <memory_resource>
+
+namespace dr
+{
+
+// Collects allocation events into a fixed-size ring buffer and writes them as Chrome trace
+// events, which can be opened in Perfetto (https://ui.perfetto.dev) or chrome://tracing.
+//
+// Recording is lock-free: writers claim a slot with a single atomic increment. Once the ring is
+// full the oldest events are overwritten, so the trace always holds the most recent ones.
+struct Tracer
+{
+    using Clock = std::chrono::steady_clock;
+
+    enum class Kind : std::uint8_t
+    {
+        allocate,
+        deallocate,
+        label,
+    };
+
+    struct Event
+    {
+        std::uint64_t time_ns;
+        const void* ptr;
+        std::size_t bytes;
+        std::ptrdiff_t curr_bytes;
+        const char* label;
+        std::uint32_t thread;
+        Kind kind;
+    };
+
+    struct Slot
+    {
+        // Index of the event last written to this slot plus one
+        std::atomic<std::uint64_t> seq{};
+        Event event{};
+    };
+
+    static constexpr std::size_t default_capacity = std::size_t{1} << 20;
+
+    std::size_t capacity;
+    std::unique_ptr<Slot[]> slots;
+    std::atomic<std::uint64_t> head{};
+    std::atomic<const char*> label{};
+    Clock::time_point start{Clock::now()};
+
+    // Capacity is rounded up to a power of two
+    Tracer(std::size_t capacity = default_capacity);
+
+    void record(Kind kind, const void* ptr, std::size_t bytes, std::ptrdiff_t curr_bytes);
+
+    // Starts a labelled slice, ending the previous one. Labels must outlive the tracer. Null ends
+    // the current slice without starting another.
+    void set_label(const char* label);
+
+    // Writes recorded events as Chrome trace JSON. Must not be called while events are being
+    // recorded. Returns false if the file can't be written.
+    bool write_chrome_trace(const char* path) const;
+};
+
+Tracer* get_tracer();
+void set_tracer(Tracer* tracer);
+
+// Sets the label of the installed tracer and stats publisher, if any
+void set_trace_label(const char* label);
+
+// Labels trace events (and published stats) for the lifetime of the scope
+struct TraceScope
+{
+    TraceScope(const char* label) { set_trace_label(label); }
+
+    TraceScope(const TraceScope&) = delete;
+    TraceScope& operator=(const TraceScope&) = delete;
+
+    ~TraceScope() { set_trace_label(nullptr); }
+};
+
+// Forwards to upstream, recording each allocation and deallocation with the tracer installed
+// when the resource is created. Forwards without recording if there isn't one.
+struct TracingMemoryResource : public std::pmr::memory_resource
+{
+    std::pmr::memory_resource* upstream;
+    Tracer* tracer{get_tracer()};
+    std::atomic<std::ptrdiff_t> curr_bytes{};
+
+    TracingMemoryResource(std::pmr::memory_resource* upstream) :
+        upstream{upstream} {}
+
+    void* do_allocate(std::size_t bytes, std::size_t alignment) override;
+    void do_deallocate(void* ptr, std::size_t bytes, std::size_t alignment) override;
+
+    bool do_is_equal(const std::pmr::memory_resource& other) const noexcept override
+    {
+        return this == &other;
+    };
+};
+
+} // namespace dr